@@ -0,0 +1,214 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+#include <QAbstractItemModelTester>
+#endif
+
+#include "../core/document.h"
+#include "../core/page.h"
+#include "../core/annotations.h"
+#include "../settings_core.h"
+#include "../ui/annotationmodel.h"
+
+class AnnotationModelTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testAddAnnotations();
+    void testRemoveAnnotations();
+    void testAddAndRemoveAnnotations();
+
+private:
+    Okular::Annotation *createAnnotation();
+    Okular::Page *page( int number ) const;
+    QList< int > modelPages() const;
+    QList< Okular::Annotation* > modelAnnotations( int page ) const;
+
+    Okular::Document *m_document;
+    AnnotationModel *m_model;
+};
+
+void AnnotationModelTest::initTestCase()
+{
+    Okular::SettingsCore::instance( QStringLiteral("annotationmodeltest") );
+    m_document = new Okular::Document( nullptr );
+}
+
+void AnnotationModelTest::init()
+{
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE( m_document->openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess );
+
+    m_model = new AnnotationModel( m_document );
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    new QAbstractItemModelTester( m_model, QAbstractItemModelTester::FailureReportingMode::QtTest, m_model );
+#endif
+}
+
+void AnnotationModelTest::cleanup()
+{
+    delete m_model;
+    m_document->closeDocument();
+}
+
+Okular::Annotation *AnnotationModelTest::createAnnotation()
+{
+    Okular::Annotation *annot = new Okular::TextAnnotation();
+    annot->setBoundingRectangle( Okular::NormalizedRect( 0.1, 0.1, 0.15, 0.15 ) );
+    annot->setContents( QStringLiteral("annot contents") );
+    return annot;
+}
+
+// the model only reacts to notifications, so changing a page behind the
+// back of the document lets a single notification carry several changes
+Okular::Page *AnnotationModelTest::page( int number ) const
+{
+    return const_cast< Okular::Page* >( m_document->page( number ) );
+}
+
+QList< int > AnnotationModelTest::modelPages() const
+{
+    QList< int > pages;
+    for ( int row = 0; row < m_model->rowCount(); ++row )
+        pages << m_model->index( row, 0 ).data( AnnotationModel::PageRole ).toInt();
+    return pages;
+}
+
+QList< Okular::Annotation* > AnnotationModelTest::modelAnnotations( int page ) const
+{
+    QList< Okular::Annotation* > annotations;
+    for ( int row = 0; row < m_model->rowCount(); ++row )
+    {
+        const QModelIndex pageIndex = m_model->index( row, 0 );
+        if ( pageIndex.data( AnnotationModel::PageRole ).toInt() != page )
+            continue;
+
+        for ( int child = 0; child < m_model->rowCount( pageIndex ); ++child )
+            annotations << m_model->annotationForIndex( m_model->index( child, 0, pageIndex ) );
+    }
+    return annotations;
+}
+
+void AnnotationModelTest::testAddAnnotations()
+{
+    QSignalSpy insertedSpy( m_model, &QAbstractItemModel::rowsInserted );
+    QCOMPARE( m_model->rowCount(), 0 );
+
+    // a first annotation creates its page branch
+    Okular::Annotation *annot1 = createAnnotation();
+    m_document->addPageAnnotation( 5, annot1 );
+    QCOMPARE( insertedSpy.count(), 1 );
+    QCOMPARE( insertedSpy.at( 0 ).at( 0 ).value< QModelIndex >(), QModelIndex() );
+    QCOMPARE( modelPages(), QList< int >() << 5 );
+    QCOMPARE( modelAnnotations( 5 ), QList< Okular::Annotation* >() << annot1 );
+
+    // new branches are kept sorted by page, before and after the existing one
+    Okular::Annotation *annot2 = createAnnotation();
+    m_document->addPageAnnotation( 2, annot2 );
+    Okular::Annotation *annot3 = createAnnotation();
+    m_document->addPageAnnotation( 9, annot3 );
+    QCOMPARE( insertedSpy.count(), 3 );
+    QCOMPARE( insertedSpy.at( 1 ).at( 1 ).toInt(), 0 );
+    QCOMPARE( insertedSpy.at( 2 ).at( 1 ).toInt(), 2 );
+    QCOMPARE( modelPages(), QList< int >() << 2 << 5 << 9 );
+
+    // another annotation on a page is appended to its branch
+    insertedSpy.clear();
+    Okular::Annotation *annot4 = createAnnotation();
+    m_document->addPageAnnotation( 5, annot4 );
+    QCOMPARE( insertedSpy.count(), 1 );
+    QCOMPARE( insertedSpy.at( 0 ).at( 0 ).value< QModelIndex >(), m_model->index( 1, 0 ) );
+    QCOMPARE( insertedSpy.at( 0 ).at( 1 ).toInt(), 1 );
+    QCOMPARE( insertedSpy.at( 0 ).at( 2 ).toInt(), 1 );
+    QCOMPARE( modelPages(), QList< int >() << 2 << 5 << 9 );
+    QCOMPARE( modelAnnotations( 5 ), QList< Okular::Annotation* >() << annot1 << annot4 );
+}
+
+void AnnotationModelTest::testRemoveAnnotations()
+{
+    Okular::Annotation *annot1 = createAnnotation();
+    m_document->addPageAnnotation( 3, annot1 );
+    Okular::Annotation *annot2 = createAnnotation();
+    m_document->addPageAnnotation( 3, annot2 );
+    Okular::Annotation *annot3 = createAnnotation();
+    m_document->addPageAnnotation( 7, annot3 );
+    QCOMPARE( modelPages(), QList< int >() << 3 << 7 );
+
+    QSignalSpy removedSpy( m_model, &QAbstractItemModel::rowsRemoved );
+
+    // removing one of several annotations keeps the branch
+    m_document->removePageAnnotation( 3, annot1 );
+    QCOMPARE( removedSpy.count(), 1 );
+    QCOMPARE( removedSpy.at( 0 ).at( 0 ).value< QModelIndex >(), m_model->index( 0, 0 ) );
+    QCOMPARE( removedSpy.at( 0 ).at( 1 ).toInt(), 0 );
+    QCOMPARE( removedSpy.at( 0 ).at( 2 ).toInt(), 0 );
+    QCOMPARE( modelAnnotations( 3 ), QList< Okular::Annotation* >() << annot2 );
+
+    // removing the last one removes the branch
+    m_document->removePageAnnotation( 3, annot2 );
+    QCOMPARE( removedSpy.count(), 2 );
+    QCOMPARE( removedSpy.at( 1 ).at( 0 ).value< QModelIndex >(), QModelIndex() );
+    QCOMPARE( removedSpy.at( 1 ).at( 1 ).toInt(), 0 );
+    QCOMPARE( modelPages(), QList< int >() << 7 );
+    QCOMPARE( modelAnnotations( 7 ), QList< Okular::Annotation* >() << annot3 );
+}
+
+void AnnotationModelTest::testAddAndRemoveAnnotations()
+{
+    QList< Okular::Annotation* > annots;
+    for ( int i = 0; i < 5; ++i )
+    {
+        annots << createAnnotation();
+        m_document->addPageAnnotation( 4, annots.last() );
+    }
+    QCOMPARE( modelAnnotations( 4 ), annots );
+
+    QSignalSpy removedSpy( m_model, &QAbstractItemModel::rowsRemoved );
+    QSignalSpy insertedSpy( m_model, &QAbstractItemModel::rowsInserted );
+    QSignalSpy dataChangedSpy( m_model, &QAbstractItemModel::dataChanged );
+
+    // drop two runs of annotations from the page, then let the addition of
+    // a new one notify the whole change at once
+    Okular::Annotation *gone1 = annots.at( 0 );
+    Okular::Annotation *gone2 = annots.at( 2 );
+    Okular::Annotation *gone3 = annots.at( 3 );
+    QVERIFY( page( 4 )->removeAnnotation( gone1 ) );
+    QVERIFY( page( 4 )->removeAnnotation( gone2 ) );
+    QVERIFY( page( 4 )->removeAnnotation( gone3 ) );
+    Okular::Annotation *added = createAnnotation();
+    m_document->addPageAnnotation( 4, added );
+
+    // runs are removed from the last one on, each with a single signal
+    QCOMPARE( removedSpy.count(), 2 );
+    QCOMPARE( removedSpy.at( 0 ).at( 1 ).toInt(), 2 );
+    QCOMPARE( removedSpy.at( 0 ).at( 2 ).toInt(), 3 );
+    QCOMPARE( removedSpy.at( 1 ).at( 1 ).toInt(), 0 );
+    QCOMPARE( removedSpy.at( 1 ).at( 2 ).toInt(), 0 );
+    QCOMPARE( insertedSpy.count(), 1 );
+    QCOMPARE( insertedSpy.at( 0 ).at( 1 ).toInt(), 2 );
+    QCOMPARE( insertedSpy.at( 0 ).at( 2 ).toInt(), 2 );
+    QCOMPARE( dataChangedSpy.count(), 0 );
+    QCOMPARE( modelAnnotations( 4 ), QList< Okular::Annotation* >() << annots.at( 1 ) << annots.at( 4 ) << added );
+
+    // the undo stack still refers to them as added, so they are ours to delete
+    delete gone1;
+    delete gone2;
+    delete gone3;
+}
+
+QTEST_MAIN( AnnotationModelTest )
+#include "annotationmodeltest.moc"
@@ -0,0 +1,252 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+#include <QAbstractItemModelTester>
+#endif
+
+#include "../core/area.h"
+#include "../core/document.h"
+#include "../core/page.h"
+#include "../core/qdanodes.h"
+#include "../core/tagging.h"
+#include "../settings_core.h"
+#include "../ui/codebookmodel.h"
+
+class CodebookModelTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testCodings();
+    void testParentCycle();
+    void testRename();
+    void testFilterProxyModel();
+
+private:
+    Okular::QDANode *createNode( const QString &name, const QString &parent = QString() );
+    Okular::Tagging *code( int page, Okular::QDANode *node, Okular::Tagging *head = nullptr );
+    Okular::QDANode *parentNode( Okular::QDANode *node ) const;
+    int count( Okular::QDANode *node ) const;
+    static void checkModel( QAbstractItemModel *model );
+
+    Okular::Document *m_document;
+    CodebookModel *m_model;
+};
+
+void CodebookModelTest::initTestCase()
+{
+    Okular::SettingsCore::instance( QStringLiteral("codebookmodeltest") );
+    m_document = new Okular::Document( nullptr );
+}
+
+void CodebookModelTest::init()
+{
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile( testFile );
+    QCOMPARE( m_document->openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess );
+
+    m_model = new CodebookModel( m_document );
+    checkModel( m_model );
+}
+
+void CodebookModelTest::cleanup()
+{
+    delete m_model;
+    m_document->closeDocument();
+
+    // the taggings are gone with the document, the nodes are ours to drop
+    qDeleteAll( Okular::QDANodeUtils::QDANodes );
+    Okular::QDANodeUtils::QDANodes.clear();
+}
+
+void CodebookModelTest::checkModel( QAbstractItemModel *model )
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 11, 0)
+    new QAbstractItemModelTester( model, QAbstractItemModelTester::FailureReportingMode::QtTest, model );
+#else
+    Q_UNUSED( model )
+#endif
+}
+
+// the parent may be given by unique name or by name, like the model accepts
+Okular::QDANode *CodebookModelTest::createNode( const QString &name, const QString &parent )
+{
+    Okular::QDANode *node = new Okular::QDANode();
+    node->setName( name );
+    if ( !parent.isEmpty() )
+        node->attributes.append( qMakePair( QStringLiteral("parent"), parent ) );
+    return node;
+}
+
+Okular::Tagging *CodebookModelTest::code( int page, Okular::QDANode *node, Okular::Tagging *head )
+{
+    const Okular::NormalizedRect rect( 0.1, 0.1, 0.2, 0.2 );
+    Okular::Tagging *tagging = new Okular::BoxTagging( head, m_document->page( page ), &rect );
+    if ( !head )
+        tagging->setNode( node );
+    m_document->addPageTagging( page, tagging );
+    return tagging;
+}
+
+Okular::QDANode *CodebookModelTest::parentNode( Okular::QDANode *node ) const
+{
+    const QModelIndex index = m_model->indexForNode( node );
+    return index.isValid() ? m_model->nodeForIndex( index.parent() ) : nullptr;
+}
+
+int CodebookModelTest::count( Okular::QDANode *node ) const
+{
+    return m_model->indexForNode( node ).data( CodebookModel::CountRole ).toInt();
+}
+
+void CodebookModelTest::testCodings()
+{
+    Okular::QDANode *animals = createNode( QStringLiteral("Animals") );
+    Okular::QDANode *cats = createNode( QStringLiteral("Cats"), animals->uniqueName() );
+    QCOMPARE( m_model->rowCount(), 0 );
+
+    // coding a node brings in its parent first
+    code( 2, cats );
+    QCOMPARE( m_model->rowCount(), 1 );
+    QCOMPARE( m_model->nodeForIndex( m_model->index( 0, 0 ) ), animals );
+    QCOMPARE( parentNode( cats ), animals );
+    QCOMPARE( count( cats ), 1 );
+    QCOMPARE( count( animals ), 0 );
+
+    Okular::Tagging *second = code( 5, cats );
+    QCOMPARE( count( cats ), 2 );
+    QCOMPARE( m_model->nextCodingPage( cats, 2 ), 5 );
+    QCOMPARE( m_model->nextCodingPage( cats, 5 ), 2 );
+    QCOMPARE( m_model->nextCodingPage( animals, 0 ), -1 );
+
+    // a coding spanning two pages counts once, on the page of its head
+    Okular::Tagging *head = code( 7, animals );
+    code( 8, animals, head );
+    QCOMPARE( count( animals ), 1 );
+    QCOMPARE( m_model->nextCodingPage( animals, 7 ), 7 );
+
+    m_document->removePageTagging( 5, second );
+    QCOMPARE( count( cats ), 1 );
+    QCOMPARE( m_model->nextCodingPage( cats, 2 ), 2 );
+}
+
+void CodebookModelTest::testParentCycle()
+{
+    // a node nested below itself, two nodes nested below each other, and
+    // a longer loop: they all end up at top level
+    Okular::QDANode *self = createNode( QStringLiteral("Self") );
+    self->attributes.append( qMakePair( QStringLiteral("parent"), self->uniqueName() ) );
+    Okular::QDANode *first = createNode( QStringLiteral("First") );
+    Okular::QDANode *second = createNode( QStringLiteral("Second"), first->uniqueName() );
+    first->attributes.append( qMakePair( QStringLiteral("parent"), second->uniqueName() ) );
+    Okular::QDANode *loop1 = createNode( QStringLiteral("Loop 1") );
+    Okular::QDANode *loop2 = createNode( QStringLiteral("Loop 2"), loop1->uniqueName() );
+    Okular::QDANode *loop3 = createNode( QStringLiteral("Loop 3"), loop2->uniqueName() );
+    loop1->attributes.append( qMakePair( QStringLiteral("parent"), loop3->uniqueName() ) );
+
+    const QList< Okular::QDANode* > nodes = QList< Okular::QDANode* >() << self << first << second << loop1 << loop2 << loop3;
+    for ( Okular::QDANode *node : nodes )
+        code( 0, node );
+
+    QCOMPARE( m_model->rowCount(), nodes.count() );
+    for ( Okular::QDANode *node : nodes )
+    {
+        QVERIFY( m_model->indexForNode( node ).isValid() );
+        QCOMPARE( parentNode( node ), static_cast< Okular::QDANode* >( nullptr ) );
+        QCOMPARE( count( node ), 1 );
+    }
+
+    // a model built from scratch agrees
+    CodebookModel rebuilt( m_document );
+    checkModel( &rebuilt );
+    QCOMPARE( rebuilt.rowCount(), nodes.count() );
+    for ( Okular::QDANode *node : nodes )
+        QVERIFY( !rebuilt.indexForNode( node ).parent().isValid() );
+}
+
+void CodebookModelTest::testRename()
+{
+    Okular::QDANode *parent = createNode( QStringLiteral("Parent") );
+    Okular::QDANode *child = createNode( QStringLiteral("Child"), QStringLiteral("Parent") );
+    code( 0, parent );
+    code( 1, child );
+    QCOMPARE( parentNode( child ), parent );
+
+    // the renamed node is refreshed with its page
+    QSignalSpy dataChangedSpy( m_model, &QAbstractItemModel::dataChanged );
+    parent->setName( QStringLiteral("Renamed") );
+    code( 0, parent );
+    QCOMPARE( dataChangedSpy.count(), 1 );
+    QCOMPARE( m_model->indexForNode( parent ).data().toString(), QStringLiteral("Renamed") );
+    QCOMPARE( count( parent ), 2 );
+
+    // the child no longer matches it once its own page changes
+    code( 1, child );
+    QCOMPARE( parentNode( child ), static_cast< Okular::QDANode* >( nullptr ) );
+    QCOMPARE( m_model->rowCount(), 2 );
+    QCOMPARE( count( child ), 2 );
+
+    // and moves below a new node taking the name
+    Okular::QDANode *newParent = createNode( QStringLiteral("Parent") );
+    code( 2, newParent );
+    code( 1, child );
+    QCOMPARE( parentNode( child ), newParent );
+    QCOMPARE( count( child ), 3 );
+    QCOMPARE( m_model->rowCount(), 2 );
+}
+
+void CodebookModelTest::testFilterProxyModel()
+{
+    Okular::QDANode *animals = createNode( QStringLiteral("Animals") );
+    Okular::QDANode *cats = createNode( QStringLiteral("Cats"), animals->uniqueName() );
+    Okular::QDANode *dogs = createNode( QStringLiteral("Dogs"), animals->uniqueName() );
+    Okular::QDANode *plants = createNode( QStringLiteral("Plants") );
+    code( 0, cats );
+    code( 0, dogs );
+    code( 0, plants );
+
+    CodebookFilterProxyModel proxy;
+    proxy.setSourceModel( m_model );
+    checkModel( &proxy );
+    QCOMPARE( proxy.rowCount(), 2 );
+
+    // a matching code keeps its ancestors, but not its siblings
+    proxy.setFilterFixedString( QStringLiteral("CAT") );
+    QCOMPARE( proxy.rowCount(), 1 );
+    const QModelIndex animalsIndex = proxy.index( 0, 0 );
+    QCOMPARE( m_model->nodeForIndex( proxy.mapToSource( animalsIndex ) ), animals );
+    QCOMPARE( proxy.rowCount( animalsIndex ), 1 );
+    QCOMPARE( m_model->nodeForIndex( proxy.mapToSource( proxy.index( 0, 0, animalsIndex ) ) ), cats );
+
+    // a code added while filtering shows up if it matches
+    Okular::QDANode *cattle = createNode( QStringLiteral("Cattle"), animals->uniqueName() );
+    code( 1, cattle );
+    QCOMPARE( proxy.rowCount( animalsIndex ), 2 );
+
+    // a matching parent does not bring its children along
+    proxy.setFilterFixedString( QStringLiteral("anim") );
+    QCOMPARE( proxy.rowCount(), 1 );
+    QCOMPARE( proxy.rowCount( proxy.index( 0, 0 ) ), 0 );
+
+    proxy.setFilterFixedString( QStringLiteral("fish") );
+    QCOMPARE( proxy.rowCount(), 0 );
+
+    proxy.setFilterFixedString( QString() );
+    QCOMPARE( proxy.rowCount(), 2 );
+    QCOMPARE( proxy.rowCount( proxy.mapFromSource( m_model->indexForNode( animals ) ) ), 3 );
+}
+
+QTEST_MAIN( CodebookModelTest )
+#include "codebookmodeltest.moc"
@@ -0,0 +1,115 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QImage>
+#include <QTransform>
+
+#include <string.h>
+
+#include "../core/global.h"
+#include "../core/utils_p.h"
+
+Q_DECLARE_METATYPE( Okular::Rotation )
+
+class RotateImageTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRotate_data();
+    void testRotate();
+    void testPaddedLines();
+
+private:
+    static QImage createImage( int width, int height );
+    static void compareRotation( const QImage &image, Okular::Rotation rotation );
+};
+
+// every pixel differs, so any misplaced one shows
+QImage RotateImageTest::createImage( int width, int height )
+{
+    QImage image( width, height, QImage::Format_ARGB32 );
+    for ( int y = 0; y < height; ++y )
+    {
+        for ( int x = 0; x < width; ++x )
+            image.setPixel( x, y, qRgba( x & 0xff, y & 0xff, ( x >> 8 ) | ( ( y >> 8 ) << 4 ), 0x80 + ( ( x + y ) & 0x7f ) ) );
+    }
+    return image;
+}
+
+void RotateImageTest::compareRotation( const QImage &image, Okular::Rotation rotation )
+{
+    QTransform matrix;
+    matrix.rotate( (int)rotation * 90 );
+    const QImage expected = image.transformed( matrix );
+    const QImage rotated = Okular::rotateImage( image, rotation );
+
+    QCOMPARE( rotated.size(), expected.size() );
+    QCOMPARE( rotated.format(), image.format() );
+    for ( int y = 0; y < expected.height(); ++y )
+    {
+        for ( int x = 0; x < expected.width(); ++x )
+        {
+            if ( rotated.pixel( x, y ) != expected.pixel( x, y ) )
+                QFAIL( qPrintable( QStringLiteral( "pixel %1,%2 differs" ).arg( x ).arg( y ) ) );
+        }
+    }
+}
+
+void RotateImageTest::testRotate_data()
+{
+    QTest::addColumn<int>( "width" );
+    QTest::addColumn<int>( "height" );
+    QTest::addColumn<Okular::Rotation>( "rotation" );
+
+    // the quarter turns move pixels in blocks of 64x64
+    const QList< QSize > sizes = QList< QSize >() << QSize( 5, 3 ) << QSize( 64, 128 ) << QSize( 131, 70 ) << QSize( 1, 200 );
+    for ( const QSize &size : sizes )
+    {
+        const QByteArray name = QByteArray::number( size.width() ) + 'x' + QByteArray::number( size.height() );
+        QTest::newRow( QByteArray( name + " 90" ).constData() ) << size.width() << size.height() << Okular::Rotation90;
+        QTest::newRow( QByteArray( name + " 180" ).constData() ) << size.width() << size.height() << Okular::Rotation180;
+        QTest::newRow( QByteArray( name + " 270" ).constData() ) << size.width() << size.height() << Okular::Rotation270;
+    }
+}
+
+void RotateImageTest::testRotate()
+{
+    QFETCH( int, width );
+    QFETCH( int, height );
+    QFETCH( Okular::Rotation, rotation );
+
+    compareRotation( createImage( width, height ), rotation );
+}
+
+void RotateImageTest::testPaddedLines()
+{
+    // lines longer than the pixels they hold, with garbage in the padding
+    const int width = 67, height = 45, bytesPerLine = ( width + 13 ) * 4;
+    const QImage source = createImage( width, height );
+    QVector< uchar > buffer( bytesPerLine * height, 0xa5 );
+    for ( int y = 0; y < height; ++y )
+        memcpy( buffer.data() + y * bytesPerLine, source.constScanLine( y ), width * 4 );
+
+    const QImage padded( buffer.constData(), width, height, bytesPerLine, QImage::Format_ARGB32 );
+    QCOMPARE( padded.bytesPerLine(), bytesPerLine );
+
+    const QList< Okular::Rotation > rotations = QList< Okular::Rotation >() << Okular::Rotation90 << Okular::Rotation180 << Okular::Rotation270;
+    for ( Okular::Rotation rotation : rotations )
+    {
+        compareRotation( padded, rotation );
+        if ( QTest::currentTestFailed() )
+            return;
+    }
+}
+
+QTEST_MAIN( RotateImageTest )
+#include "rotateimagetest.moc"
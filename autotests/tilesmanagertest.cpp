@@ -0,0 +1,123 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include <QtTest>
+
+#include <QPixmap>
+#include <qmath.h>
+
+#include "../core/area.h"
+#include "../core/tile.h"
+#include "../core/tilesmanager_p.h"
+
+class TilesManagerTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testRenderCost_data();
+    void testRenderCost();
+    void testCleanupPixmapMemory();
+
+private:
+    static int terminalTiles( int tileSide, double msPerMegapixel );
+};
+
+// The number of tiles a page made of 4x4 tiles of tileSide pixels is split
+// into when the whole page is asked for: a tile is split as long as it has
+// at least as many pixels as the biggest tile allowed. The geometry of a
+// tile includes its right and bottom edges, hence the smaller page.
+int TilesManagerTest::terminalTiles( int tileSide, double msPerMegapixel )
+{
+    const int pageSide = 4 * ( tileSide - 1 );
+    Okular::TilesManager manager( 0, pageSide, pageSide );
+    manager.setRenderCost( msPerMegapixel );
+    return manager.tilesAt( Okular::NormalizedRect( 0, 0, 1, 1 ), Okular::TilesManager::TerminalTile ).count();
+}
+
+void TilesManagerTest::testRenderCost_data()
+{
+    QTest::addColumn<double>( "msPerMegapixel" );
+    QTest::addColumn<int>( "tileMaxSize" );
+
+    // the size is halved from 2000000 pixels until a tile renders in about
+    // 150 ms, or doubled while it still would, within [500000, 4000000]
+    QTest::newRow( "unknown" ) << 0.0 << 2000000;
+    QTest::newRow( "on target" ) << 75.0 << 2000000;
+    QTest::newRow( "cheap" ) << 30.0 << 4000000;
+    QTest::newRow( "free" ) << 0.001 << 4000000;
+    QTest::newRow( "slow" ) << 100.0 << 1000000;
+    QTest::newRow( "between powers of two" ) << 80.0 << 1000000;
+    QTest::newRow( "slower" ) << 200.0 << 500000;
+    QTest::newRow( "very slow" ) << 100000.0 << 500000;
+}
+
+void TilesManagerTest::testRenderCost()
+{
+    QFETCH( double, msPerMegapixel );
+    QFETCH( int, tileMaxSize );
+
+    // a tile of exactly the maximum size is split in four, one just below it
+    // is not; the latter is also above half the maximum, so that a size
+    // which is off by a power of two is told apart
+    const int side = qCeil( qSqrt( tileMaxSize ) );
+    QVERIFY( side * side >= tileMaxSize );
+    QVERIFY( ( side - 1 ) * ( side - 1 ) < tileMaxSize );
+    QVERIFY( ( side - 1 ) * ( side - 1 ) >= tileMaxSize / 2 );
+
+    QCOMPARE( terminalTiles( side, msPerMegapixel ), 64 );
+    QCOMPARE( terminalTiles( side - 1, msPerMegapixel ), 16 );
+}
+
+void TilesManagerTest::testCleanupPixmapMemory()
+{
+    // two pages of 16 unsplit tiles of 201x201 pixels each, as the geometry
+    // of a tile includes its right and bottom edges
+    const int tileBytes = 4 * 201 * 201;
+    QPixmap pixmap( 801, 801 );
+    pixmap.fill( Qt::white );
+    const Okular::NormalizedRect page( 0, 0, 1, 1 );
+
+    Okular::TilesManager first( 0, 800, 800 );
+    Okular::TilesManager second( 1, 800, 800 );
+    first.setPixmap( &pixmap, page, false );
+    second.setPixmap( &pixmap, page, false );
+    QCOMPARE( first.totalMemory(), qulonglong( 16 * tileBytes ) );
+    QCOMPARE( second.totalMemory(), qulonglong( 16 * tileBytes ) );
+
+    // only the tile at the center of the second row of the first page is
+    // visible
+    const Okular::NormalizedRect visible( 0.3, 0.3, 0.45, 0.45 );
+    QList< QPair< Okular::TilesManager *, Okular::NormalizedRect > > managers;
+    managers << qMakePair( &first, visible ) << qMakePair( &second, Okular::NormalizedRect() );
+
+    // painting the first page makes its tiles the most recently used, so the
+    // least recently used ones are taken from the second page first
+    QCOMPARE( first.tilesAt( page, Okular::TilesManager::PixmapTile ).count(), 16 );
+    QCOMPARE( Okular::TilesManager::cleanupPixmapMemory( 4 * tileBytes, managers ), qulonglong( 4 * tileBytes ) );
+    QCOMPARE( first.totalMemory(), qulonglong( 16 * tileBytes ) );
+    QCOMPARE( second.totalMemory(), qulonglong( 12 * tileBytes ) );
+
+    // and the other way round
+    QCOMPARE( second.tilesAt( page, Okular::TilesManager::PixmapTile ).count(), 12 );
+    QCOMPARE( Okular::TilesManager::cleanupPixmapMemory( 4 * tileBytes, managers ), qulonglong( 4 * tileBytes ) );
+    QCOMPARE( first.totalMemory(), qulonglong( 12 * tileBytes ) );
+    QCOMPARE( second.totalMemory(), qulonglong( 12 * tileBytes ) );
+    QVERIFY( first.hasPixmap( visible ) );
+
+    // asking for everything leaves the visible tile alone
+    QCOMPARE( Okular::TilesManager::cleanupPixmapMemory( 32 * tileBytes, managers ), qulonglong( 23 * tileBytes ) );
+    QCOMPARE( first.totalMemory(), qulonglong( tileBytes ) );
+    QCOMPARE( second.totalMemory(), qulonglong( 0 ) );
+    QVERIFY( first.hasPixmap( visible ) );
+    QVERIFY( !first.hasPixmap( page ) );
+}
+
+QTEST_MAIN( TilesManagerTest )
+#include "tilesmanagertest.moc"
@@ -160,6 +160,11 @@ struct RunningSearch
 
 #define OKULAR_HISTORY_MAXSTEPS 100
 #define OKULAR_HISTORY_SAVEDSTEPS 10
+#define OKULAR_PREVIEW_SCALE 4
+#define OKULAR_PREVIEW_MIN_PIXELS 1000000L
+#define OKULAR_TILING_MIN_PIXELS 4000000L
+#define OKULAR_TILING_MAX_PIXELS 16000000L
+#define OKULAR_RENDER_COST_MIN_PIXELS 100000L
 
 /***** Document ******/
 
@@ -225,11 +230,36 @@ QString DocumentPrivate::localizedSize(const QSizeF &size) const
     }
 }
 
-qulonglong DocumentPrivate::calculateMemoryToFree()
+qulonglong DocumentPrivate::pixmapMemoryBudget()
 {
     // [MEM] choose memory parameters based on configuration profile
+    switch ( SettingsCore::memoryLevel() )
+    {
+        case SettingsCore::EnumMemoryLevel::Low:
+            break;
+
+        case SettingsCore::EnumMemoryLevel::Normal:
+            return getTotalMemory() / 3;
+
+        case SettingsCore::EnumMemoryLevel::Aggressive:
+            return getFreeMemory();
+
+        case SettingsCore::EnumMemoryLevel::Greedy:
+        {
+            qulonglong freeSwap;
+            qulonglong freeMemory = getFreeMemory( &freeSwap );
+            return qMin( qMax( freeMemory, getTotalMemory()/2 ), freeMemory+freeSwap );
+        }
+    }
+
+    return 0;
+}
+
+qulonglong DocumentPrivate::calculateMemoryToFree()
+{
     qulonglong clipValue = 0;
     qulonglong memoryToFree = 0;
+    const qulonglong memoryBudget = pixmapMemoryBudget();
 
     switch ( SettingsCore::memoryLevel() )
     {
@@ -239,27 +269,16 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
 
         case SettingsCore::EnumMemoryLevel::Normal:
         {
-            qulonglong thirdTotalMemory = getTotalMemory() / 3;
             qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > thirdTotalMemory) memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
+            if (m_allocatedPixmapsTotalMemory > memoryBudget) memoryToFree = m_allocatedPixmapsTotalMemory - memoryBudget;
             if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
         }
         break;
 
         case SettingsCore::EnumMemoryLevel::Aggressive:
-        {
-            qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
-        }
-        break;
         case SettingsCore::EnumMemoryLevel::Greedy:
-        {
-            qulonglong freeSwap;
-            qulonglong freeMemory = getFreeMemory( &freeSwap );
-            const qulonglong memoryLimit = qMin( qMax( freeMemory, getTotalMemory()/2 ), freeMemory+freeSwap );
-            if (m_allocatedPixmapsTotalMemory > memoryLimit) clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
-        }
-        break;
+            if (m_allocatedPixmapsTotalMemory > memoryBudget) clipValue = (m_allocatedPixmapsTotalMemory - memoryBudget) / 2;
+            break;
     }
 
     if ( clipValue > memoryToFree )
@@ -268,6 +287,22 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     return memoryToFree;
 }
 
+void DocumentPrivate::calculateTilingThresholds( qulonglong *startTiling, qulonglong *stopTiling )
+{
+    // [MEM] a page above the threshold is rendered in tiles. If not set by
+    // the user, allow an untiled page to take up to 1/32 of the memory
+    // calculateMemoryToFree() lets pixmaps use; Low keeps none, so it tiles
+    // from the minimum on
+    qulonglong threshold = qulonglong( SettingsCore::tilingThreshold() ) * 1000000;
+    if ( threshold == 0 )
+        threshold = qBound( (qulonglong)OKULAR_TILING_MIN_PIXELS, pixmapMemoryBudget() / ( 4 * 32 ), (qulonglong)OKULAR_TILING_MAX_PIXELS );
+
+    // stop tiling a bit below, so that zooming around the threshold does
+    // not switch back and forth
+    *startTiling = threshold;
+    *stopTiling = threshold / 4 * 3;
+}
+
 void DocumentPrivate::cleanupPixmapMemory()
 {
     cleanupPixmapMemory( calculateMemoryToFree() );
@@ -278,8 +313,6 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
     if ( memoryToFree < 1 )
         return;
 
-    const int currentViewportPage = (*m_viewportIterator).pageNumber;
-
     // Create a QMap of visible rects, indexed by page number
     QMap< int, VisiblePageRect * > visibleRects;
     QVector< Okular::VisiblePageRect * >::const_iterator vIt = m_pageRects.constBegin(), vEnd = m_pageRects.constEnd();
@@ -307,55 +340,64 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
         pagesFreed++;
         // delete pixmap
         m_pagesVector.at( p->page )->deletePixmap( p->observer );
+        emit m_parent->pixmapsDeleted( p->observer, p->page );
         // delete allocation descriptor
         delete p;
     }
 
-    // If we're still on low memory, try to free individual tiles
-
-    // Store pages that weren't completely removed
-
-    QLinkedList< AllocatedPixmap * > pixmapsToKeep;
-    while (memoryToFree > 0)
+    // If we're still on low memory, try to free individual tiles, least
+    // recently used first whichever page and observer they belong to
+    if ( memoryToFree > 0 )
     {
-        int clean_hits = 0;
-        foreach (DocumentObserver *observer, m_observers)
+        QList< QPair< TilesManager *, NormalizedRect > > tilesManagers;
+        foreach ( AllocatedPixmap *p, m_allocatedPixmaps )
         {
-            AllocatedPixmap * p = searchLowestPriorityPixmap( false, true, observer );
-            if ( !p ) // No pixmap to remove
+            TilesManager *tilesManager = m_pagesVector.at( p->page )->d->tilesManager( p->observer );
+            if ( !tilesManager || tilesManager->totalMemory() == 0 )
                 continue;
 
-            clean_hits++;
+            NormalizedRect visibleRect;
+            if ( visibleRects.contains( p->page ) )
+                visibleRect = visibleRects[ p->page ]->rect;
+            tilesManagers.append( qMakePair( tilesManager, visibleRect ) );
+        }
 
-            TilesManager *tilesManager = m_pagesVector.at( p->page )->d->tilesManager( observer );
-            if ( tilesManager && tilesManager->totalMemory() > 0 )
-            {
-                qulonglong memoryDiff = p->memory;
-                NormalizedRect visibleRect;
-                if ( visibleRects.contains( p->page ) )
-                    visibleRect = visibleRects[ p->page ]->rect;
+        if ( !tilesManagers.isEmpty() )
+        {
+            TilesManager::cleanupPixmapMemory( memoryToFree, tilesManagers );
 
-                // Free non visible tiles
-                tilesManager->cleanupPixmapMemory( memoryToFree, visibleRect, currentViewportPage );
+            // Update the allocation descriptors of the pages, and drop the
+            // ones with no tiles left
+            QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmaps.begin();
+            while ( aIt != m_allocatedPixmaps.end() )
+            {
+                AllocatedPixmap *p = *aIt;
+                TilesManager *tilesManager = m_pagesVector.at( p->page )->d->tilesManager( p->observer );
+                if ( !tilesManager )
+                {
+                    ++aIt;
+                    continue;
+                }
 
-                p->memory = tilesManager->totalMemory();
-                memoryDiff -= p->memory;
-                memoryToFree = (memoryDiff < memoryToFree) ? (memoryToFree - memoryDiff) : 0;
-                m_allocatedPixmapsTotalMemory -= memoryDiff;
+                const qulonglong memory = tilesManager->totalMemory();
+                if ( memory < p->memory )
+                {
+                    m_allocatedPixmapsTotalMemory -= p->memory - memory;
+                    p->memory = memory;
+                    emit m_parent->pixmapsDeleted( p->observer, p->page );
+                }
 
-                if ( p->memory > 0 )
-                    pixmapsToKeep.append( p );
-                else
+                if ( p->memory == 0 )
+                {
+                    aIt = m_allocatedPixmaps.erase( aIt );
                     delete p;
+                }
+                else
+                    ++aIt;
             }
-            else
-                pixmapsToKeep.append( p );
         }
-
-        if (clean_hits == 0) break;
     }
 
-    m_allocatedPixmaps += pixmapsToKeep;
     //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
 }
 
@@ -1366,6 +1408,9 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
             maxDistance = qAbs( pixmapToReplace->page - currentViewportPage );
     }
 
+    qulonglong startTilingPixels, stopTilingPixels;
+    calculateTilingThresholds( &startTilingPixels, &stopTilingPixels );
+
     // find a request
     PixmapRequest * request = nullptr;
     m_pixmapRequestsMutex.lock();
@@ -1405,8 +1450,8 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
             m_pixmapRequestsStack.pop_back();
             delete r;
         }
-        // If the requested area is above 8000000 pixels, switch on the tile manager
-        else if ( !tilesManager && m_generator->hasFeature( Generator::TiledRendering ) && (long)r->width() * (long)r->height() > 8000000L )
+        // If the requested area is above the tiling threshold, switch on the tile manager
+        else if ( !tilesManager && m_generator->hasFeature( Generator::TiledRendering ) && (qulonglong)r->width() * (qulonglong)r->height() > startTilingPixels )
         {
             // if the image is too big. start using tiles
             qCDebug(OkularCoreDebug).nospace() << "Start using tiles on page " << r->pageNumber()
@@ -1425,9 +1470,11 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 // create new tiles manager
                 tilesManager = new TilesManager( r->pageNumber(), r->width(), r->height(), r->page()->rotation() );
             }
+            tilesManager->setRenderCost( m_renderCostPerMegapixel );
             tilesManager->setRequest( r->normalizedRect(), r->width(), r->height() );
             r->page()->deletePixmap( r->observer() );
             r->page()->d->setTilesManager( r->observer(), tilesManager );
+            emit m_parent->pixmapsDeleted( r->observer(), r->pageNumber() );
             r->setTile( true );
 
             // Change normalizedRect to the smallest rect that contains all
@@ -1461,14 +1508,15 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 delete r;
             }
         }
-        // If the requested area is below 6000000 pixels, switch off the tile manager
-        else if ( tilesManager && (long)r->width() * (long)r->height() < 6000000L )
+        // If the requested area is below the tiling threshold, switch off the tile manager
+        else if ( tilesManager && (qulonglong)r->width() * (qulonglong)r->height() < stopTilingPixels )
         {
             qCDebug(OkularCoreDebug).nospace() << "Stop using tiles on page " << r->pageNumber()
                 << " (" << r->width() << "x" << r->height() << " px);";
 
             // page is too small. stop using tiles.
             r->page()->deletePixmap( r->observer() );
+            emit m_parent->pixmapsDeleted( r->observer(), r->pageNumber() );
             r->setTile( false );
 
             request = r;
@@ -1498,6 +1546,21 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         return;
     }
 
+    // [PROGRESSIVE] if there is nothing close enough to show for this page
+    // yet, render a quick preview first and queue the full request behind
+    // the other requests of the same priority
+    PixmapRequest *preview = m_generator->canGeneratePixmap() ? createPreviewRequest( request ) : nullptr;
+    if ( preview )
+    {
+        request->d->mPreviewSent = true;
+        m_pixmapRequestsStack.removeAll( request );
+        QLinkedList< PixmapRequest * >::iterator sIt = m_pixmapRequestsStack.begin(), sEnd = m_pixmapRequestsStack.end();
+        while ( sIt != sEnd && (*sIt)->priority() > request->priority() )
+            ++sIt;
+        m_pixmapRequestsStack.insert( sIt, request );
+        request = preview;
+    }
+
     // [MEM] preventive memory freeing
     qulonglong pixmapBytes = 0;
     TilesManager * tm = request->d->tilesManager();
@@ -1517,7 +1580,10 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         m_pixmapRequestsStack.removeAll ( request );
 
         if ( tm )
+        {
+            tm->setRenderCost( m_renderCostPerMegapixel );
             tm->setRequest( request->normalizedRect(), request->width(), request->height() );
+        }
 
         if ( (int)m_rotation % 2 )
             request->d->swap();
@@ -1537,6 +1603,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         // we can not really know if the generator can do async requests
         m_executingPixmapRequests.push_back( request );
         m_pixmapRequestsMutex.unlock();
+        request->d->mRenderTimer.start();
         m_generator->generatePixmap( request );
     }
     else
@@ -1547,6 +1614,32 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
     }
 }
 
+PixmapRequest * DocumentPrivate::createPreviewRequest( PixmapRequest *request ) const
+{
+    // previews only make sense when rendering happens in the background,
+    // and not for tiles, preloads, sync requests or small pixmaps
+    if ( request->d->mPreview || request->d->mPreviewSent || request->isTile() || request->d->tilesManager()
+         || request->preload() || !request->asynchronous() || !m_generator->hasFeature( Generator::Threaded )
+         || (long)request->width() * (long)request->height() < OKULAR_PREVIEW_MIN_PIXELS )
+        return nullptr;
+
+    // any cached pixmap at least as detailed as a preview is already a good
+    // enough placeholder; this also avoids rendering the preview again when
+    // the full request is queued anew before it was served
+    const QPixmap *nearest = request->page()->_o_nearestPixmap( request->observer(), request->width(), request->height() );
+    if ( nearest && nearest->width() * OKULAR_PREVIEW_SCALE >= request->width() )
+        return nullptr;
+
+    PixmapRequest *preview = new PixmapRequest( request->observer(), request->pageNumber(), request->width(), request->height(),
+                                                request->priority(), PixmapRequest::Asynchronous );
+    // set the size directly, the constructor would apply the device pixel ratio again
+    preview->d->mWidth = qMax( 1, request->width() / OKULAR_PREVIEW_SCALE );
+    preview->d->mHeight = qMax( 1, request->height() / OKULAR_PREVIEW_SCALE );
+    preview->d->mPage = request->page();
+    preview->d->mPreview = true;
+    return preview;
+}
+
 void DocumentPrivate::rotationFinished( int page, Okular::Page *okularPage )
 {
     Okular::Page *wantedPage = m_pagesVector.value( page, 0 );
@@ -1609,6 +1702,7 @@ void DocumentPrivate::slotGeneratorConfigChanged( const QString& )
         qDeleteAll( m_allocatedPixmaps );
         m_allocatedPixmaps.clear();
         m_allocatedPixmapsTotalMemory = 0;
+        emit m_parent->pixmapsDeleted( nullptr, -1 );
 
         // send reload signals to observers
         foreachObserverD( notifyContentsCleared( DocumentObserver::Pixmap ) );
@@ -1630,7 +1724,7 @@ void DocumentPrivate::refreshPixmaps( int pageNumber )
     QVector< Okular::PixmapRequest * > pixmapsToRequest;
     for ( ; it != itEnd; ++it )
     {
-        const QSize size = (*it).m_pixmap->size();
+        const QSize size = page->d->rotatedPixmapSize( *it );
         PixmapRequest * p = new PixmapRequest( it.key(), pageNumber, size.width() / qApp->devicePixelRatio(), size.height() / qApp->devicePixelRatio(), 1, PixmapRequest::Asynchronous );
         p->d->mForce = true;
         pixmapsToRequest << p;
@@ -2795,6 +2889,7 @@ void Document::closeDocument()
     for ( ; pIt != pEnd; ++pIt )
         delete *pIt;
     d->m_pagesVector.clear();
+    emit pixmapsDeleted( nullptr, -1 );
 
     // clear 'memory allocation' descriptors
     qDeleteAll( d->m_allocatedPixmaps );
@@ -2821,6 +2916,7 @@ void Document::closeDocument()
     d->m_viewportHistory.append( DocumentViewport() );
     d->m_viewportIterator = d->m_viewportHistory.begin();
     d->m_allocatedPixmapsTotalMemory = 0;
+    d->m_renderCostPerMegapixel = 0;
     d->m_allocatedTextPagesFifo.clear();
     d->m_pageSize = PageSize();
     d->m_pageSizes.clear();
@@ -2863,6 +2959,7 @@ void Document::removeObserver( DocumentObserver * pObserver )
         QVector<Page*>::const_iterator it = d->m_pagesVector.constBegin(), end = d->m_pagesVector.constEnd();
         for ( ; it != end; ++it )
             (*it)->deletePixmap( pObserver );
+        emit pixmapsDeleted( pObserver, -1 );
 
         // [MEM] free observer's allocation descriptors
         QLinkedList< AllocatedPixmap * >::iterator aIt = d->m_allocatedPixmaps.begin();
@@ -2913,6 +3010,7 @@ void Document::reparseConfig()
         qDeleteAll( d->m_allocatedPixmaps );
         d->m_allocatedPixmaps.clear();
         d->m_allocatedPixmapsTotalMemory = 0;
+        emit pixmapsDeleted( nullptr, -1 );
 
         // send reload signals to observers
         foreachObserver( notifyContentsCleared( DocumentObserver::Pixmap ) );
@@ -5306,6 +5404,15 @@ void DocumentPrivate::requestDone( PixmapRequest * req )
 
     if ( !req->shouldAbortRender() )
     {
+        // [MEM] 1.0 keep track of the render cost, which sizes the tiles
+        const QRect renderedRect = req->isTile() ? req->normalizedRect().geometry( req->width(), req->height() ) : QRect( 0, 0, req->width(), req->height() );
+        const qint64 renderedPixels = (qint64)renderedRect.width() * renderedRect.height();
+        if ( req->d->mRenderTimer.isValid() && renderedPixels >= OKULAR_RENDER_COST_MIN_PIXELS )
+        {
+            const double renderCost = req->d->mRenderTimer.elapsed() * 1000000.0 / renderedPixels;
+            m_renderCostPerMegapixel = m_renderCostPerMegapixel > 0 ? 0.75 * m_renderCostPerMegapixel + 0.25 * renderCost : renderCost;
+        }
+
         // [MEM] 1.1 find and remove a previous entry for the same page and id
         QLinkedList< AllocatedPixmap * >::iterator aIt = m_allocatedPixmaps.begin();
         QLinkedList< AllocatedPixmap * >::iterator aEnd = m_allocatedPixmaps.end();
@@ -1272,6 +1272,15 @@ class OKULARCORE_EXPORT Document : public QObject
          * @since 1.4
          */
         void refreshFormWidget( Okular::FormField *field );
+
+        /**
+         * This signal is emitted whenever the pixmaps of the @p observer on
+         * the page @p page are deleted, to free memory or because they are
+         * of no use anymore. A null @p observer stands for all the observers,
+         * a @p page of -1 for all the pages.
+         * @since 1.6
+         */
+        void pixmapsDeleted( Okular::DocumentObserver *observer, int page );
     private:
         /// @cond PRIVATE
         friend class DocumentPrivate;
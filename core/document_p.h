@@ -108,6 +108,7 @@ class DocumentPrivate
             m_allocatedPixmapsTotalMemory( 0 ),
             m_maxAllocatedTextPages( 0 ),
             m_warnedOutOfMemory( false ),
+            m_renderCostPerMegapixel( 0 ),
             m_rotation( Rotation0 ),
             m_exportCached( false ),
             m_bookmarkManager( nullptr ),
@@ -135,10 +136,13 @@ class DocumentPrivate
         QString pagesSizeString() const;
         QString namePaperSize(double inchesWidth, double inchesHeight) const;
         QString localizedSize(const QSizeF &size) const;
+        qulonglong pixmapMemoryBudget();
         qulonglong calculateMemoryToFree();
+        void calculateTilingThresholds( qulonglong *startTiling, qulonglong *stopTiling );
         void cleanupPixmapMemory();
         void cleanupPixmapMemory( qulonglong memoryToFree );
         AllocatedPixmap * searchLowestPriorityPixmap( bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = nullptr /* any */ );
+        PixmapRequest * createPreviewRequest( PixmapRequest *request ) const;
         void calculateMaxTextPages();
         qulonglong getTotalMemory();
         qulonglong getFreeMemory( qulonglong *freeSwap = nullptr );
@@ -267,6 +271,8 @@ class DocumentPrivate
         QList< int > m_allocatedTextPagesFifo;
         int m_maxAllocatedTextPages;
         bool m_warnedOutOfMemory;
+        // average time (in ms) the generator takes to render a megapixel
+        double m_renderCostPerMegapixel;
 
         // the rotation applied to the document
         Rotation m_rotation;
@@ -591,6 +591,8 @@ PixmapRequest::PixmapRequest( DocumentObserver *observer, int pageNumber, int wi
     d->mTile = false;
     d->mNormalizedRect = NormalizedRect();
     d->mPartialUpdatesWanted = false;
+    d->mPreview = false;
+    d->mPreviewSent = false;
     d->mShouldAbortRender = 0;
 }
 
@@ -15,6 +15,7 @@
 
 #include "area.h"
 
+#include <QElapsedTimer>
 #include <QSet>
 #include <QThread>
 #include <QImage>
@@ -92,10 +93,13 @@ class PixmapRequestPrivate
         bool mForce : 1;
         bool mTile : 1;
         bool mPartialUpdatesWanted : 1;
+        bool mPreview : 1;
+        bool mPreviewSent : 1;
         Page *mPage;
         NormalizedRect mNormalizedRect;
         QAtomicInt mShouldAbortRender;
         QImage mResultImage;
+        QElapsedTimer mRenderTimer;
 };
 
 
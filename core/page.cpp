@@ -116,6 +116,8 @@ void PagePrivate::imageRotationDone( RotationJob * job )
     if ( it != m_pixmaps.end() )
     {
         PixmapObject &object = it.value();
+        // release the old pixmap first, not to hold both at the same time
+        (*object.m_pixmap) = QPixmap();
         (*object.m_pixmap) = QPixmap::fromImage( job->image() );
         object.m_rotation = job->rotation();
     } else {
@@ -127,6 +129,26 @@ void PagePrivate::imageRotationDone( RotationJob * job )
     }
 }
 
+QSize PagePrivate::rotatedPixmapSize( const PixmapObject &object ) const
+{
+    const QSize size = object.m_pixmap->size();
+    return ( (int)object.m_rotation + (int)m_rotation ) % 2 ? size.transposed() : size;
+}
+
+void PagePrivate::rotatePixmap( PixmapObject &object )
+{
+    if ( object.m_rotation == m_rotation )
+        return;
+
+    const Rotation rotation = (Rotation)( ( (int)m_rotation - (int)object.m_rotation + 4 ) % 4 );
+    const QImage image = object.m_pixmap->toImage();
+    // the image shares the data of the pixmap, so dropping the pixmap first
+    // keeps only the source and the rotated copy around
+    (*object.m_pixmap) = QPixmap();
+    (*object.m_pixmap) = QPixmap::fromImage( Okular::rotateImage( image, rotation ) );
+    object.m_rotation = m_rotation;
+}
+
 QTransform PagePrivate::rotationMatrix() const
 {
     return Okular::buildRotationMatrix( m_rotation );
@@ -238,9 +260,8 @@ bool Page::hasPixmap( DocumentObserver *observer, int width, int height, const N
     if ( width == -1 || height == -1 )
         return true;
 
-    const QPixmap *pixmap = it.value().m_pixmap;
-
-    return (pixmap->width() == width && pixmap->height() == height);
+    // the pixmap may still have to be turned to the rotation of the page
+    return d->rotatedPixmapSize( it.value() ) == QSize( width, height );
 }
 
 bool Page::hasTextPage() const
@@ -466,18 +487,9 @@ void PagePrivate::rotateAt( Rotation orientation )
     m_rotation = orientation;
 
     /**
-     * Rotate the images of the page.
+     * The images of the page are rotated when they are used next, see
+     * rotatePixmap().
      */
-    QMapIterator< DocumentObserver*, PagePrivate::PixmapObject > it( m_pixmaps );
-    while ( it.hasNext() ) {
-        it.next();
-
-        const PagePrivate::PixmapObject &object = it.value();
-
-        RotationJob *job = new RotationJob( object.m_pixmap->toImage(), object.m_rotation, m_rotation, it.key() );
-        job->setPage( this );
-        m_doc->m_pageController->addRotationJob(job);
-    }
 
     /**
      * Rotate tiles manager
@@ -806,6 +818,11 @@ bool Page::hasTaggings() const
     return !m_taggings.isEmpty();
 }
 
+QLinkedList< Tagging* > Page::taggings() const
+{
+    return m_taggings;
+}
+
 
 Tagging * Page::tagging( const QString & uniqueName ) const
 {
@@ -1249,30 +1266,34 @@ const QPixmap * Page::_o_nearestPixmap( DocumentObserver *observer, int w, int h
 {
     Q_UNUSED( h )
 
-    const QPixmap * pixmap = nullptr;
+    PagePrivate::PixmapObject * object = nullptr;
 
     // if a pixmap is present for given id, use it
-    QMap< DocumentObserver*, PagePrivate::PixmapObject >::const_iterator itPixmap = d->m_pixmaps.constFind( observer );
-    if ( itPixmap != d->m_pixmaps.constEnd() )
-        pixmap = itPixmap.value().m_pixmap;
+    QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator itPixmap = d->m_pixmaps.find( observer );
+    if ( itPixmap != d->m_pixmaps.end() )
+        object = &itPixmap.value();
     // else find the closest match using pixmaps of other IDs (great optim!)
     else if ( !d->m_pixmaps.isEmpty() )
     {
         int minDistance = -1;
-        QMap< DocumentObserver*, PagePrivate::PixmapObject >::const_iterator it = d->m_pixmaps.constBegin(), end = d->m_pixmaps.constEnd();
+        QMap< DocumentObserver*, PagePrivate::PixmapObject >::iterator it = d->m_pixmaps.begin(), end = d->m_pixmaps.end();
         for ( ; it != end; ++it )
         {
-            int pixWidth = (*it).m_pixmap->width(),
+            int pixWidth = d->rotatedPixmapSize( *it ).width(),
                 distance = pixWidth > w ? pixWidth - w : w - pixWidth;
             if ( minDistance == -1 || distance < minDistance )
             {
-                pixmap = (*it).m_pixmap;
+                object = &it.value();
                 minDistance = distance;
             }
         }
     }
 
-    return pixmap;
+    if ( !object )
+        return nullptr;
+
+    d->rotatePixmap( *object );
+    return object->m_pixmap;
 }
 
 bool Page::hasTilesManager( const DocumentObserver *observer ) const
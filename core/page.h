@@ -377,6 +377,11 @@ class OKULARCORE_EXPORT Page
          */
         bool hasTaggings() const;
 
+        /**
+         * Returns the list of taggings of the page.
+         */
+        QLinkedList< Tagging* > taggings() const;
+
         /**
          * Returns the annotation with the given unique name.
          */
@@ -17,6 +17,7 @@
 // qt/kde includes
 #include <qlinkedlist.h>
 #include <qmap.h>
+#include <qsize.h>
 #include <qtransform.h>
 #include <qstring.h>
 #include <qdom.h>
@@ -143,6 +144,20 @@ class PagePrivate
                 QPixmap *m_pixmap = nullptr;
                 Rotation m_rotation;
         };
+
+        /**
+         * Returns the size @p object will have once turned to the rotation
+         * of the page.
+         */
+        QSize rotatedPixmapSize( const PixmapObject &object ) const;
+
+        /**
+         * Turns the pixmap of @p object to the rotation of the page, if it
+         * has not been done yet. Cached pixmaps are rotated lazily, when
+         * they are first used after the page has been rotated.
+         */
+        void rotatePixmap( PixmapObject &object );
+
         QMap< DocumentObserver*, PixmapObject > m_pixmaps;
         QMap< const DocumentObserver*, TilesManager *> m_tilesManagers;
 
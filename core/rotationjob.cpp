@@ -9,7 +9,7 @@
 
 #include "rotationjob_p.h"
 
-#include <QTransform>
+#include "core/utils_p.h"
 
 using namespace Okular;
 
@@ -56,43 +56,6 @@ bool RotationJob::isPartialUpdate() const
     return mIsPartialUpdate;
 }
 
-QTransform RotationJob::rotationMatrix( Rotation from, Rotation to )
-{
-    QTransform matrix;
-
-    if ( from == Rotation0 ) {
-        if ( to == Rotation90 )
-            matrix.rotate( 90 );
-        else if ( to == Rotation180 )
-            matrix.rotate( 180 );
-        else if ( to == Rotation270 )
-            matrix.rotate( 270 );
-    } else if ( from == Rotation90 ) {
-        if ( to == Rotation180 )
-            matrix.rotate( 90 );
-        else if ( to == Rotation270 )
-            matrix.rotate( 180 );
-        else if ( to == Rotation0 )
-            matrix.rotate( 270 );
-    } else if ( from == Rotation180 ) {
-        if ( to == Rotation270 )
-            matrix.rotate( 90 );
-        else if ( to == Rotation0 )
-            matrix.rotate( 180 );
-        else if ( to == Rotation90 )
-            matrix.rotate( 270 );
-    } else if ( from == Rotation270 ) {
-        if ( to == Rotation0 )
-            matrix.rotate( 90 );
-        else if ( to == Rotation90 )
-            matrix.rotate( 180 );
-        else if ( to == Rotation180 )
-            matrix.rotate( 270 );
-    }
-
-    return matrix;
-}
-
 RotationJobInternal::RotationJobInternal( const QImage &image, Rotation oldRotation, Rotation newRotation )
     : mImage( image ), mOldRotation( oldRotation ), mNewRotation( newRotation )
 {
@@ -115,12 +78,15 @@ void RotationJobInternal::run(ThreadWeaver::JobPointer self, ThreadWeaver::Threa
 
     if ( mOldRotation == mNewRotation ) {
         mRotatedImage = mImage;
+        mImage = QImage();
         return;
     }
 
-    const QTransform matrix = RotationJob::rotationMatrix( mOldRotation, mNewRotation );
+    const Rotation rotation = (Rotation)( ( (int)mNewRotation - (int)mOldRotation + 4 ) % 4 );
+    mRotatedImage = rotateImage( mImage, rotation );
 
-    mRotatedImage = mImage.transformed( matrix );
+    // let go of the source as soon as possible, it may be big
+    mImage = QImage();
 }
 
 #include "moc_rotationjob_p.cpp"
@@ -11,7 +11,6 @@
 #define _OKULAR_ROTATIONJOB_P_H_
 
 #include <QImage>
-#include <QTransform>
 
 #include <threadweaver/qobjectdecorator.h>
 #include <threadweaver/job.h>
@@ -39,7 +38,7 @@ class RotationJobInternal : public ThreadWeaver::Job
     private:
         RotationJobInternal( const QImage &image, Rotation oldRotation, Rotation newRotation );
 
-        const QImage mImage;
+        QImage mImage;
         Rotation mOldRotation;
         Rotation mNewRotation;
         QImage mRotatedImage;
@@ -62,8 +61,6 @@ class RotationJob : public ThreadWeaver::QObjectDecorator
         NormalizedRect rect() const;
         bool isPartialUpdate() const;
 
-        static QTransform rotationMatrix( Rotation from, Rotation to );
-
     private:
         DocumentObserver *mObserver;
         PagePrivate * m_pd;
@@ -30,6 +30,9 @@
 
 using namespace Okular;
 
+// the number of pages whose display list is kept around
+static const int MaxDisplayLists = 32;
+
 /**
  * Generic Converter Implementation
  */
@@ -80,20 +83,44 @@ TextDocumentGenerator* TextDocumentConverter::generator() const
  */
 Okular::TextPage* TextDocumentGeneratorPrivate::createTextPage( int pageNumber ) const
 {
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    Q_Q( const TextDocumentGenerator );
-#endif
-
     Okular::TextPage *textPage = new Okular::TextPage;
 
-    int start, end;
+    const QSharedPointer<const PageDisplayList> list = displayList( pageNumber );
+    if ( list ) {
+        for ( const QPair<QString, NormalizedRect> &entry : list->text )
+            textPage->append( entry.first, new Okular::NormalizedRect( entry.second ) );
+    }
 
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    q->userMutex()->lock();
-#endif
-    TextDocumentUtils::calculatePositions( mDocument, pageNumber, start, end );
+    return textPage;
+}
+
+QSharedPointer<const TextDocumentGeneratorPrivate::PageDisplayList> TextDocumentGeneratorPrivate::displayList( int pageNumber ) const
+{
+    QMutexLocker locker( &mDocumentMutex );
+
+    QSharedPointer<const PageDisplayList> list = mDisplayLists.value( pageNumber );
+    if ( list ) {
+        mDisplayListsOrder.removeOne( pageNumber );
+        mDisplayListsOrder.append( pageNumber );
+        return list;
+    }
+
+    if ( !mDocument )
+        return list;
+
+    PageDisplayList *newList = new PageDisplayList;
+
+    // record the drawing commands of the page with its top left corner at the origin
+    const QRect pageRect( 0, pageNumber * mPageSize.height(), mPageSize.width(), mPageSize.height() );
+    QPainter p( &newList->picture );
+    p.translate( 0, -pageRect.top() );
+    p.setClipRect( pageRect );
+    drawPage( &p, pageNumber, pageRect );
+    p.end();
+
+    int start, end;
+    calculatePositions( pageNumber, start, end );
 
-    {
     QTextCursor cursor( mDocument );
     for ( int i = start; i < end - 1; ++i ) {
         cursor.setPosition( i );
@@ -102,19 +129,132 @@ Okular::TextPage* TextDocumentGeneratorPrivate::createTextPage( int pageNumber )
         QString text = cursor.selectedText();
         if ( text.length() == 1 ) {
             QRectF rect;
-            TextDocumentUtils::calculateBoundingRect( mDocument, i, i + 1, rect, pageNumber );
-            if ( pageNumber == -1 )
+            int page;
+            TextDocumentUtils::calculateBoundingRect( mDocument, i, i + 1, rect, page );
+            if ( page == -1 )
                 text = QStringLiteral("\n");
 
-            textPage->append( text, new Okular::NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) );
+            newList->text.append( qMakePair( text, NormalizedRect( rect.left(), rect.top(), rect.right(), rect.bottom() ) ) );
         }
     }
+
+    list = QSharedPointer<const PageDisplayList>( newList );
+    mDisplayLists.insert( pageNumber, list );
+    mDisplayListsOrder.append( pageNumber );
+    while ( mDisplayListsOrder.count() > MaxDisplayLists )
+        mDisplayLists.remove( mDisplayListsOrder.takeFirst() );
+
+    return list;
+}
+
+void TextDocumentGeneratorPrivate::clearDisplayLists()
+{
+    mDisplayLists.clear();
+    mDisplayListsOrder.clear();
+}
+
+void TextDocumentGeneratorPrivate::calculatePositions( int page, int &start, int &end ) const
+{
+    if ( page >= 0 && page < mPagePositions.count() ) {
+        const PagePosition &position = mPagePositions.at( page );
+        start = position.startPosition;
+        end = position.endPosition;
+    } else {
+        TextDocumentUtils::calculatePositions( mDocument, page, start, end );
     }
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    q->userMutex()->unlock();
-#endif
+}
 
-    return textPage;
+void TextDocumentGeneratorPrivate::calculatePagePositions()
+{
+    mPagePositions.clear();
+
+    if ( !mDocument )
+        return;
+
+    const int pageCount = mDocument->pageCount();
+    const qreal pageHeight = mDocument->pageSize().height();
+    if ( pageCount <= 0 || pageHeight <= 0 )
+        return;
+
+    mPagePositions.resize( pageCount );
+    for ( int i = 0; i < pageCount; ++i ) {
+        PagePosition &position = mPagePositions[ i ];
+        TextDocumentUtils::calculatePositions( mDocument, i, position.startPosition, position.endPosition );
+        position.firstBlock = -1;
+        position.lastBlock = -1;
+        position.simpleBlocks = true;
+    }
+
+    // the document layout draws frame borders and backgrounds, list
+    // markers, tables and rulers itself, pages with any of them are
+    // still painted through it
+    const QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+    const QTextFrame *rootFrame = mDocument->rootFrame();
+    const QTextFrameFormat rootFormat = rootFrame->frameFormat();
+    const bool simpleRootFrame = rootFormat.border() == 0 && rootFormat.background().style() == Qt::NoBrush;
+
+    for ( QTextBlock block = mDocument->begin(); block.isValid(); block = block.next() ) {
+        if ( !block.isVisible() )
+            continue;
+
+        const QRectF rect = layout->blockBoundingRect( block );
+        if ( rect.height() <= 0 )
+            continue;
+
+        const int firstPage = qBound( 0, int( rect.top() / pageHeight ), pageCount - 1 );
+        const int lastPage = qBound( firstPage, int( qMax( rect.top(), rect.bottom() - 1 ) / pageHeight ), pageCount - 1 );
+
+        const bool simpleBlock = simpleRootFrame && !block.textList() &&
+                                 !block.blockFormat().hasProperty( QTextFormat::BlockTrailingHorizontalRulerWidth ) &&
+                                 QTextCursor( block ).currentFrame() == rootFrame;
+
+        for ( int page = firstPage; page <= lastPage; ++page ) {
+            PagePosition &position = mPagePositions[ page ];
+            if ( position.firstBlock == -1 )
+                position.firstBlock = block.blockNumber();
+            position.lastBlock = block.blockNumber();
+            if ( !simpleBlock )
+                position.simpleBlocks = false;
+        }
+    }
+}
+
+void TextDocumentGeneratorPrivate::drawPage( QPainter *painter, int page, const QRectF &clip ) const
+{
+    if ( page < 0 || page >= mPagePositions.count() || !mPagePositions.at( page ).simpleBlocks ) {
+        QAbstractTextDocumentLayout::PaintContext context;
+        context.palette.setColor( QPalette::Text, Qt::black );
+//  FIXME Fix Qt, this doesn't work, we have horrible hacks
+//        in the generators that return html, remove that code
+//        if Qt ever gets fixed
+//     context.palette.setColor( QPalette::Link, Qt::blue );
+        context.clip = clip;
+        mDocument->documentLayout()->draw( painter, context );
+        return;
+    }
+
+    const PagePosition &position = mPagePositions.at( page );
+    if ( position.firstBlock == -1 )
+        return;
+
+    const QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+    painter->setPen( Qt::black );
+
+    QTextBlock block = mDocument->findBlockByNumber( position.firstBlock );
+    for ( int i = position.firstBlock; i <= position.lastBlock && block.isValid(); ++i, block = block.next() ) {
+        if ( !block.isVisible() || !block.layout() )
+            continue;
+
+        const QRectF rect = layout->blockBoundingRect( block );
+        if ( !rect.intersects( clip ) )
+            continue;
+
+        const QBrush background = block.blockFormat().background();
+        if ( background.style() != Qt::NoBrush )
+            painter->fillRect( rect, background );
+
+        block.layout()->draw( painter, rect.topLeft(), QVector<QTextLayout::FormatRange>(), clip );
+    }
 }
 
 void TextDocumentGeneratorPrivate::addAction( Action *action, int cursorBegin, int cursorEnd )
@@ -246,10 +386,8 @@ void TextDocumentGeneratorPrivate::initializeGenerator()
     q->setFeature( Generator::TextExtraction );
     q->setFeature( Generator::PrintNative );
     q->setFeature( Generator::PrintToFile );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     if ( QFontDatabase::supportsThreadedFontRendering() )
         q->setFeature( Generator::Threaded );
-#endif
 
     QObject::connect( mConverter, SIGNAL(addAction(Action*,int,int)),
                       q, SLOT(addAction(Action*,int,int)) );
@@ -308,6 +446,9 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
         return openResult;
     }
     d->mDocument = d->mConverter->document();
+    d->mDocument->setDefaultFont( d->mFont );
+    d->mPageSize = d->mDocument->pageSize().toSize();
+    d->calculatePagePositions();
 
     d->generateTitleInfos();
     d->generateLinkInfos();
@@ -355,12 +496,15 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword( const QStr
 bool TextDocumentGenerator::doCloseDocument()
 {
     Q_D( TextDocumentGenerator );
+    QMutexLocker locker( &d->mDocumentMutex );
     delete d->mDocument;
     d->mDocument = nullptr;
+    d->clearDisplayLists();
 
     d->mTitlePositions.clear();
     d->mLinkPositions.clear();
     d->mLinkInfos.clear();
+    d->mPagePositions.clear();
     d->mAnnotationPositions.clear();
     d->mAnnotationInfos.clear();
     // do not use clear() for the following two, otherwise they change type
@@ -382,13 +526,10 @@ void TextDocumentGenerator::generatePixmap( Okular::PixmapRequest * request )
 
 QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
 {
-    if ( !mDocument )
+    const QSharedPointer<const PageDisplayList> list = displayList( request->pageNumber() );
+    if ( !list )
         return QImage();
 
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    Q_Q( TextDocumentGenerator );
-#endif
-
     QImage image( request->width(), request->height(), QImage::Format_ARGB32 );
     image.fill( Qt::white );
 
@@ -398,29 +539,8 @@ QImage TextDocumentGeneratorPrivate::image( PixmapRequest * request )
     qreal width = request->width();
     qreal height = request->height();
 
-    const QSize size = mDocument->pageSize().toSize();
-
-    p.scale( width / (qreal)size.width(), height / (qreal)size.height() );
-
-    QRect rect;
-    rect = QRect( 0, request->pageNumber() * size.height(), size.width(), size.height() );
-    p.translate( QPoint( 0, request->pageNumber() * size.height() * -1 ) );
-    p.setClipRect( rect );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    q->userMutex()->lock();
-#endif
-    QAbstractTextDocumentLayout::PaintContext context;
-    context.palette.setColor( QPalette::Text, Qt::black );
-//  FIXME Fix Qt, this doesn't work, we have horrible hacks
-//        in the generators that return html, remove that code
-//        if Qt ever gets fixed
-//     context.palette.setColor( QPalette::Link, Qt::blue );
-    context.clip = rect;
-    mDocument->setDefaultFont( mFont );
-    mDocument->documentLayout()->draw( &p, context );
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    q->userMutex()->unlock();
-#endif
+    p.scale( width / (qreal)mPageSize.width(), height / (qreal)mPageSize.height() );
+    p.drawPicture( 0, 0, list->picture );
     p.end();
 
     return image;
@@ -435,6 +555,7 @@ Okular::TextPage* TextDocumentGenerator::textPage( Okular::TextRequest * request
 bool TextDocumentGenerator::print( QPrinter& printer )
 {
     Q_D( TextDocumentGenerator );
+    QMutexLocker locker( &d->mDocumentMutex );
     if ( !d->mDocument )
         return false;
 
@@ -488,6 +609,7 @@ Okular::ExportFormat::List TextDocumentGenerator::exportFormats(   ) const
 bool TextDocumentGenerator::exportTo( const QString &fileName, const Okular::ExportFormat &format )
 {
     Q_D( TextDocumentGenerator );
+    QMutexLocker locker( &d->mDocumentMutex );
     if ( !d->mDocument )
         return false;
 
@@ -530,6 +652,14 @@ bool TextDocumentGenerator::reparseConfig()
 
     if ( newFont != d->mFont ) {
         d->mFont = newFont;
+        QMutexLocker locker( &d->mDocumentMutex );
+        if ( d->mDocument ) {
+            // the new font changes the layout, so the page partition and
+            // the recorded pages have to follow
+            d->mDocument->setDefaultFont( d->mFont );
+            d->calculatePagePositions();
+            d->clearDisplayLists();
+        }
         return true;
     }
 
@@ -11,10 +11,16 @@
 #define _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 
 #include <QAbstractTextDocumentLayout>
+#include <QHash>
+#include <QMutex>
+#include <QPicture>
+#include <QSharedPointer>
 #include <QTextBlock>
 #include <QTextDocument>
+#include <QVector>
 
 #include "action.h"
+#include "area.h"
 #include "document.h"
 #include "generator_p.h"
 #include "textdocumentgenerator.h"
@@ -135,8 +141,23 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
 
         void calculateBoundingRect( int startPosition, int endPosition, QRectF &rect, int &page ) const;
         void calculatePositions( int page, int &start, int &end ) const;
+        void calculatePagePositions();
+        void drawPage( QPainter *painter, int page, const QRectF &clip ) const;
         Okular::TextPage* createTextPage( int ) const;
 
+        /**
+         * The finalised content of a page, recorded once from the layout.
+         * Rendering and text extraction only read it, so they can run
+         * concurrently without touching mDocument.
+         */
+        struct PageDisplayList
+        {
+          QPicture picture;
+          QVector< QPair<QString, NormalizedRect> > text;
+        };
+        QSharedPointer<const PageDisplayList> displayList( int page ) const;
+        void clearDisplayLists();
+
         void addAction( Action *action, int cursorBegin, int cursorEnd );
         void addAnnotation( Annotation *annotation, int cursorBegin, int cursorEnd );
         void addTitle( int level, const QString &title, const QTextBlock &position );
@@ -193,6 +214,28 @@ class TextDocumentGeneratorPrivate : public GeneratorPrivate
         };
         QList<AnnotationInfo> mAnnotationInfos;
 
+        /**
+         * The character and block range of a page of the laid out document,
+         * computed once after layout so that rendering and text extraction
+         * do not need to hit test the layout again.
+         */
+        struct PagePosition
+        {
+          int startPosition;
+          int endPosition;
+          int firstBlock;
+          int lastBlock;
+          // whether all the blocks of the page can be drawn by their own QTextLayout
+          bool simpleBlocks;
+        };
+        QVector<PagePosition> mPagePositions;
+        QSize mPageSize;
+
+        // guards mDocument and the display list cache
+        mutable QMutex mDocumentMutex;
+        mutable QHash< int, QSharedPointer<const PageDisplayList> > mDisplayLists;
+        mutable QList<int> mDisplayListsOrder;
+
         TextDocumentSettings *mGeneralSettings;
 
         QFont mFont;
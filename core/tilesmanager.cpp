@@ -8,24 +8,40 @@
 
 #include "tilesmanager_p.h"
 
+#include <QImage>
 #include <QPixmap>
 #include <qmath.h>
 #include <QList>
-#include <QPainter>
+#include <QVector>
+
+#include <algorithm>
 
 #include "tile.h"
+#include "utils_p.h"
 
 #define TILES_MAXSIZE 2000000
+#define TILES_MINSIZE 500000
+#define TILES_TARGET_RENDER_TIME 150
 
 using namespace Okular;
 
-static bool rankedTilesLessThan( TileNode *t1, TileNode *t2 )
+// Stamp of the last use of a tile, shared by all the tiles managers so that
+// the tiles of every page and observer can be ranked together
+static qulonglong tilesClock = 0;
+
+struct RankedTile
+{
+    TileNode *node;
+    TilesManager *manager;
+};
+
+static bool rankedTilesLessThan( const RankedTile &t1, const RankedTile &t2 )
 {
-    // Order tiles by its dirty state and then by distance from the viewport.
-    if ( t1->dirty == t2->dirty )
-        return t1->distance < t2->distance;
+    // Order tiles by its dirty state and then by the time of their last use.
+    if ( t1.node->dirty == t2.node->dirty )
+        return t1.node->lastUsed < t2.node->lastUsed;
 
-    return !t1->dirty;
+    return t1.node->dirty;
 }
 
 class TilesManager::Private
@@ -48,7 +64,7 @@ class TilesManager::Private
         void deleteTiles( const TileNode &tile );
 
         void markParentDirty( const TileNode &tile );
-        void rankTiles( TileNode &tile, QList<TileNode*> &rankedTiles, const NormalizedRect &visibleRect, int visiblePageNumber );
+        void rankTiles( TileNode &tile, QVector<RankedTile> &rankedTiles, const NormalizedRect &visibleRect, TilesManager *manager );
         /**
          * Since the tile can be large enough to occupy a significant amount of
          * space, they may be split in more tiles. This operation is performed
@@ -67,6 +83,7 @@ class TilesManager::Private
 
         // The page is split in a 4x4 grid of tiles
         TileNode tiles[16];
+        int tileMaxSize;
         int width;
         int height;
         int pageNumber;
@@ -79,7 +96,8 @@ class TilesManager::Private
 };
 
 TilesManager::Private::Private()
-    : width( 0 )
+    : tileMaxSize( TILES_MAXSIZE )
+    , width( 0 )
     , height( 0 )
     , pageNumber( 0 )
     , totalPixels( 0 )
@@ -154,6 +172,24 @@ int TilesManager::height() const
     return d->height;
 }
 
+void TilesManager::setRenderCost( double msPerMegapixel )
+{
+    if ( msPerMegapixel <= 0 )
+        return;
+
+    // Pick the biggest tile which still renders in about
+    // TILES_TARGET_RENDER_TIME ms. Sizes only change by powers of two, so
+    // that small variations of the cost do not split and merge tiles all
+    // the time.
+    int size = TILES_MAXSIZE;
+    while ( size > TILES_MINSIZE && size * msPerMegapixel / 1000000 > TILES_TARGET_RENDER_TIME )
+        size /= 2;
+    while ( size < 2 * TILES_MAXSIZE && 2 * size * msPerMegapixel / 1000000 <= TILES_TARGET_RENDER_TIME )
+        size *= 2;
+
+    d->tileMaxSize = size;
+}
+
 void TilesManager::setRotation( Rotation rotation )
 {
     if ( rotation == d->rotation )
@@ -266,6 +302,7 @@ void TilesManager::Private::setPixmap( const QPixmap *pixmap, const NormalizedRe
             {
                 const NormalizedRect rotatedRect = TilesManager::toRotatedRect( tile.rect, rotation );
                 tile.pixmap = new QPixmap( pixmap->copy( rotatedRect.geometry( width, height ).translated( -pixmapRect.topLeft() ) ) );
+                tile.lastUsed = ++tilesClock;
                 totalPixels += tile.pixmap->width()*tile.pixmap->height();
             }
             else
@@ -291,7 +328,7 @@ void TilesManager::Private::setPixmap( const QPixmap *pixmap, const NormalizedRe
         QRect tileRect = tile.rect.geometry( width, height );
         // sets the pixmap of the children tiles. if the tile's size is too
         // small, discards the children tiles and use the current one
-        if ( tileRect.width()*tileRect.height() >= TILES_MAXSIZE )
+        if ( tileRect.width()*tileRect.height() >= tileMaxSize )
         {
             tile.dirty = isPartialPixmap;
             if ( tile.pixmap )
@@ -328,6 +365,7 @@ void TilesManager::Private::setPixmap( const QPixmap *pixmap, const NormalizedRe
             {
                 const NormalizedRect rotatedRect = TilesManager::toRotatedRect( tile.rect, rotation );
                 tile.pixmap = new QPixmap( pixmap->copy( rotatedRect.geometry( width, height ).translated( -pixmapRect.topLeft() ) ) );
+                tile.lastUsed = ++tilesClock;
                 totalPixels += tile.pixmap->width()*tile.pixmap->height();
             }
             else
@@ -406,50 +444,15 @@ void TilesManager::Private::tilesAt( const NormalizedRect &rect, TileNode &tile,
         if ( tile.pixmap && tileLeaf == PixmapTile && tile.rotation != rotation )
         {
             // Lazy tiles rotation
-            int angleToRotate = (rotation - tile.rotation)*90;
-            int xOffset = 0, yOffset = 0;
-            int w = 0, h = 0;
-            switch( angleToRotate )
-            {
-                case 0:
-                    xOffset = 0;
-                    yOffset = 0;
-                    w = tile.pixmap->width();
-                    h = tile.pixmap->height();
-                    break;
-                case 90:
-                case -270:
-                    xOffset = 0;
-                    yOffset = -tile.pixmap->height();
-                    w = tile.pixmap->height();
-                    h = tile.pixmap->width();
-                    break;
-                case 180:
-                case -180:
-                    xOffset = -tile.pixmap->width();
-                    yOffset = -tile.pixmap->height();
-                    w = tile.pixmap->width();
-                    h = tile.pixmap->height();
-                    break;
-                case 270:
-                case -90:
-                    xOffset = -tile.pixmap->width();
-                    yOffset = 0;
-                    w = tile.pixmap->height();
-                    h = tile.pixmap->width();
-                    break;
-            }
-            QPixmap *rotatedPixmap = new QPixmap( w, h );
-            QPainter p( rotatedPixmap );
-            p.rotate( angleToRotate );
-            p.translate( xOffset, yOffset );
-            p.drawPixmap( 0, 0, *tile.pixmap );
-            p.end();
-
+            const Rotation angleToRotate = (Rotation)( ( (int)rotation - (int)tile.rotation + 4 ) % 4 );
+            const QImage image = tile.pixmap->toImage();
+            // drop the pixmap first, the image shares its data
             delete tile.pixmap;
-            tile.pixmap = rotatedPixmap;
+            tile.pixmap = new QPixmap( QPixmap::fromImage( rotateImage( image, angleToRotate ) ) );
             tile.rotation = rotation;
         }
+        if ( tile.pixmap && tileLeaf == PixmapTile )
+            tile.lastUsed = ++tilesClock;
         result.append( Tile( rotatedRect, tile.pixmap, tile.isValid() ) );
     }
     else
@@ -464,37 +467,37 @@ qulonglong TilesManager::totalMemory() const
     return 4*d->totalPixels;
 }
 
-void TilesManager::cleanupPixmapMemory( qulonglong numberOfBytes, const NormalizedRect &visibleRect, int visiblePageNumber )
+qulonglong TilesManager::cleanupPixmapMemory( qulonglong numberOfBytes, const QList< QPair< TilesManager *, NormalizedRect > > &managers )
 {
-    QList<TileNode*> rankedTiles;
-    for ( int i = 0; i < 16; ++i )
+    QVector<RankedTile> rankedTiles;
+    for ( const QPair< TilesManager *, NormalizedRect > &manager : managers )
     {
-        d->rankTiles( d->tiles[ i ], rankedTiles, visibleRect, visiblePageNumber );
+        for ( int i = 0; i < 16; ++i )
+        {
+            manager.first->d->rankTiles( manager.first->d->tiles[ i ], rankedTiles, manager.second, manager.first );
+        }
     }
-    qSort( rankedTiles.begin(), rankedTiles.end(), rankedTilesLessThan );
+    std::sort( rankedTiles.begin(), rankedTiles.end(), rankedTilesLessThan );
 
-    while ( numberOfBytes > 0 && !rankedTiles.isEmpty() )
+    qulonglong freedBytes = 0;
+    for ( const RankedTile &rankedTile : qAsConst( rankedTiles ) )
     {
-        TileNode *tile = rankedTiles.takeLast();
-        if ( !tile->pixmap )
-            continue;
-
-        // do not evict visible pixmaps
-        if ( tile->rect.intersects( visibleRect ) )
-            continue;
+        if ( freedBytes >= numberOfBytes )
+            break;
 
+        TileNode *tile = rankedTile.node;
+        TilesManager::Private *d = rankedTile.manager->d;
         qulonglong pixels = tile->pixmap->width()*tile->pixmap->height();
         d->totalPixels -= pixels;
-        if ( numberOfBytes < 4*pixels )
-            numberOfBytes = 0;
-        else
-            numberOfBytes -= 4*pixels;
+        freedBytes += 4*pixels;
 
         delete tile->pixmap;
         tile->pixmap = nullptr;
 
         d->markParentDirty( *tile );
     }
+
+    return freedBytes;
 }
 
 void TilesManager::Private::markParentDirty( const TileNode &tile )
@@ -509,42 +512,22 @@ void TilesManager::Private::markParentDirty( const TileNode &tile )
     }
 }
 
-void TilesManager::Private::rankTiles( TileNode &tile, QList<TileNode*> &rankedTiles, const NormalizedRect &visibleRect, int visiblePageNumber )
+void TilesManager::Private::rankTiles( TileNode &tile, QVector<RankedTile> &rankedTiles, const NormalizedRect &visibleRect, TilesManager *manager )
 {
-    // If the page is visible, visibleRect is not null.
-    // Otherwise we use the number of one of the visible pages to calculate the
-    // distance.
-    // Note that the current page may be visible and yet its pageNumber is
-    // different from visiblePageNumber. Since we only use this value on hidden
-    // pages, any visible page number will fit.
-    if ( visibleRect.isNull() && visiblePageNumber < 0 )
-        return;
-
     if ( tile.pixmap )
     {
-        // Update distance
-        if ( !visibleRect.isNull() )
-        {
-            NormalizedPoint viewportCenter = visibleRect.center();
-            NormalizedPoint tileCenter = tile.rect.center();
-            // Manhattan distance. It's a good and fast approximation.
-            tile.distance = qAbs(viewportCenter.x - tileCenter.x) + qAbs(viewportCenter.y - tileCenter.y);
-        }
-        else
+        // do not evict visible pixmaps
+        if ( visibleRect.isNull() || !tile.rect.intersects( visibleRect ) )
         {
-            // For non visible pages only the vertical distance is used
-            if ( pageNumber < visiblePageNumber )
-                tile.distance = 1 - tile.rect.bottom;
-            else
-                tile.distance = tile.rect.top;
+            const RankedTile rankedTile = { &tile, manager };
+            rankedTiles.append( rankedTile );
         }
-        rankedTiles.append( &tile );
     }
     else
     {
         for ( int i = 0; i < tile.nTiles; ++i )
         {
-            rankTiles( tile.tiles[ i ], rankedTiles, visibleRect, visiblePageNumber );
+            rankTiles( tile.tiles[ i ], rankedTiles, visibleRect, manager );
         }
     }
 }
@@ -564,7 +547,7 @@ void TilesManager::setRequest( const NormalizedRect &rect, int pageWidth, int pa
 bool TilesManager::Private::splitBigTiles( TileNode &tile, const NormalizedRect &rect )
 {
     QRect tileRect = tile.rect.geometry( width, height );
-    if ( tileRect.width()*tileRect.height() < TILES_MAXSIZE )
+    if ( tileRect.width()*tileRect.height() < tileMaxSize )
         return false;
 
     split( tile, rect );
@@ -650,7 +633,7 @@ TileNode::TileNode()
     : pixmap( nullptr )
     , rotation( Rotation0 )
     , dirty ( true )
-    , distance( -1 )
+    , lastUsed( 0 )
     , tiles( nullptr )
     , nTiles( 0 )
     , parent( nullptr )
@@ -12,6 +12,8 @@
 #include "okularcore_export.h"
 #include "area.h"
 
+#include <QPair>
+
 class QPixmap;
 
 namespace Okular {
@@ -25,8 +27,9 @@ class Tile;
  * structure.
  * Each node stores the pixmap of a tile and its location on the page.
  * There's a limit on the size of the pixmaps (TILES_MAXSIZE, defined in
- * tilesmanager.cpp), and tiles that are bigger than that value are split into
- * four children tiles, which are stored as children of the original tile.
+ * tilesmanager.cpp and adjusted to the render cost of the generator), and
+ * tiles that are bigger than that value are split into four children tiles,
+ * which are stored as children of the original tile.
  * If children tiles are still too big, they are recursively split again.
  * If the zoom level changes and a big tile goes below the limit, it is merged
  * back into a leaf tile.
@@ -70,10 +73,11 @@ class TileNode
         bool dirty;
 
         /**
-         * Distance between the tile and the viewport.
+         * Stamp of the last time the pixmap of the tile was set or painted,
+         * shared by all the tiles managers.
          * This is used by the evicting algorithm.
          */
-        double distance;
+        qulonglong lastUsed;
 
         /**
          * Children tiles
@@ -95,7 +99,7 @@ class TileNode
  * grid of 16 tiles. Then each of these tiles can be recursively split in 4
  * subtiles so that we keep the size of each pixmap inside a safe interval.
  */
-class TilesManager
+class OKULARCORE_EXPORT TilesManager
 {
     public:
         enum TileLeaf
@@ -142,13 +146,16 @@ class TilesManager
         qulonglong totalMemory() const;
 
         /**
-         * Removes at least @p numberOfBytes bytes worth of tiles (least ranked
-         * tiles are removed first).
-         * Set @p visibleRect to the visible region of the page. Set a
-         * @p visiblePageNumber if the current page is not visible.
-         * Visible tiles are not discarded.
+         * Removes at least @p numberOfBytes bytes worth of tiles from all the
+         * @p managers, each paired with the visible region of its page (or a
+         * null rect if the page is not visible).
+         * Dirty tiles are removed first, then the least recently used ones,
+         * whichever page and observer they belong to. Visible tiles are not
+         * discarded.
+         *
+         * Returns the number of bytes actually freed.
          */
-        void cleanupPixmapMemory( qulonglong numberOfBytes, const NormalizedRect &visibleRect, int visiblePageNumber );
+        static qulonglong cleanupPixmapMemory( qulonglong numberOfBytes, const QList< QPair< TilesManager *, NormalizedRect > > &managers );
 
         /**
          * Checks whether a given region has already been requested
@@ -176,6 +183,12 @@ class TilesManager
          */
         int height() const;
 
+        /**
+         * Inform the time the generator takes to render a megapixel, so that
+         * tiles are sized to render in a bounded time
+         */
+        void setRenderCost( double msPerMegapixel );
+
         /**
          * Inform the new rotation of the page
          */
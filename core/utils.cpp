@@ -26,6 +26,10 @@
 
 using namespace Okular;
 
+// Side of the square blocks the quarter turns are done in, so that the
+// source rows and the destination columns of a block stay in cache
+static const int rotationBlockSize = 64;
+
 QRect Utils::rotateRect( const QRect & source, int width, int height, int orientation )
 {
     QRect ret;
@@ -169,4 +173,75 @@ QTransform Okular::buildRotationMatrix(Rotation rotation)
     return matrix;
 }
 
+QImage Okular::rotateImage( const QImage &image, Rotation rotation )
+{
+    if ( rotation == Rotation0 || image.isNull() )
+        return image;
+
+    // pixels are moved around as 32 bit words, other depths take the slow path
+    if ( image.depth() != 32 )
+    {
+        QTransform matrix;
+        matrix.rotate( (int)rotation * 90 );
+        return image.transformed( matrix );
+    }
+
+    const int width = image.width();
+    const int height = image.height();
+    QImage rotated = rotation == Rotation180 ? QImage( width, height, image.format() ) : QImage( height, width, image.format() );
+    if ( rotated.isNull() )
+    {
+        qCWarning(OkularCoreDebug) << "Not enough memory to rotate a" << width << "x" << height << "image";
+        return QImage();
+    }
+    rotated.setDevicePixelRatio( image.devicePixelRatio() );
+
+    const qptrdiff srcStride = image.bytesPerLine() / 4;
+    const qptrdiff dstStride = rotated.bytesPerLine() / 4;
+    const quint32 *src = reinterpret_cast< const quint32 * >( image.constBits() );
+    quint32 *dst = reinterpret_cast< quint32 * >( rotated.bits() );
+
+    if ( rotation == Rotation180 )
+    {
+        // each row goes reversed to the mirrored row
+        for ( int y = 0; y < height; ++y )
+        {
+            const quint32 *srcLine = src + y * srcStride;
+            quint32 *dstLine = dst + ( height - 1 - y ) * dstStride + width - 1;
+            for ( int x = 0; x < width; ++x )
+                dstLine[ -x ] = srcLine[ x ];
+        }
+        return rotated;
+    }
+
+    for ( int blockY = 0; blockY < height; blockY += rotationBlockSize )
+    {
+        const int yEnd = qMin( blockY + rotationBlockSize, height );
+        for ( int blockX = 0; blockX < width; blockX += rotationBlockSize )
+        {
+            const int xEnd = qMin( blockX + rotationBlockSize, width );
+            for ( int y = blockY; y < yEnd; ++y )
+            {
+                const quint32 *srcLine = src + y * srcStride;
+                if ( rotation == Rotation90 )
+                {
+                    // ( x, y ) goes to ( height - 1 - y, x )
+                    quint32 *dstColumn = dst + height - 1 - y;
+                    for ( int x = blockX; x < xEnd; ++x )
+                        dstColumn[ x * dstStride ] = srcLine[ x ];
+                }
+                else
+                {
+                    // ( x, y ) goes to ( y, width - 1 - x )
+                    quint32 *dstColumn = dst + y;
+                    for ( int x = blockX; x < xEnd; ++x )
+                        dstColumn[ ( width - 1 - x ) * dstStride ] = srcLine[ x ];
+                }
+            }
+        }
+    }
+
+    return rotated;
+}
+
 /* kate: replace-tabs on; indent-width 4; */
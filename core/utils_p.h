@@ -10,7 +10,11 @@
 #ifndef _OKULAR_UTILS_P_H_
 #define _OKULAR_UTILS_P_H_
 
+#include "okularcore_export.h"
+
+class QImage;
 class QIODevice;
+class QTransform;
 
 namespace Okular
 {
@@ -22,6 +26,11 @@ void copyQIODevice( QIODevice *from, QIODevice *to );
  */
 QTransform buildRotationMatrix( Rotation rotation );
 
+/**
+ * Return @p image turned clockwise by @p rotation.
+ */
+OKULARCORE_EXPORT QImage rotateImage( const QImage &image, Rotation rotation );
+
 }
 
 #endif
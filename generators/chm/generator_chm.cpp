@@ -11,7 +11,6 @@
 #include "generator_chm.h"
 
 #include <QEventLoop>
-#include <QMutex>
 #include <QPainter>
 #include <QDomElement>
 
@@ -31,6 +30,9 @@
 
 OKULAR_EXPORT_PLUGIN(CHMGenerator, "libokularGenerator_chmlib.json")
 
+// budget of the recorded page layouts, in KiB
+static const int PageLayoutsSize = 32 * 1024;
+
 static QString absolutePath( const QString &baseUrl, const QString &path )
 {
     QString absPath;
@@ -49,11 +51,12 @@ static QString absolutePath( const QString &baseUrl, const QString &path )
 }
 
 CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
-    : Okular::Generator( parent, args )
+    : Okular::Generator( parent, args ), m_layouts( PageLayoutsSize )
 {
     setFeature( TextExtraction );
 
     m_syncGen=0;
+    m_textGen=0;
     m_file=0;
     m_request = 0;
 }
@@ -61,6 +64,7 @@ CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
 CHMGenerator::~CHMGenerator()
 {
     delete m_syncGen;
+    delete m_textGen;
 }
 
 bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page * > & pagesVector )
@@ -134,7 +138,6 @@ bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     }
 
     pagesVector.resize(m_pageUrl.count());
-    m_textpageAddedList.fill(false, pagesVector.count());
     m_rectsGenerated.fill(false, pagesVector.count());
 
     if (!m_syncGen)
@@ -161,8 +164,8 @@ bool CHMGenerator::doCloseDocument()
     // delete the document information of the old document
     delete m_file;
     m_file=0;
-    m_textpageAddedList.clear();
     m_rectsGenerated.clear();
+    m_layouts.clear();
     m_urlPage.clear();
     m_pageUrl.clear();
     m_docSyn.clear();
@@ -170,6 +173,7 @@ bool CHMGenerator::doCloseDocument()
     {
         m_syncGen->closeUrl();
     }
+    m_request = 0;
 
     return true;
 }
@@ -195,34 +199,77 @@ void CHMGenerator::slotCompleted()
     if ( !m_request )
         return;
 
-    QImage image( m_request->width(), m_request->height(), QImage::Format_ARGB32 );
-    image.fill( Qt::white );
+    Okular::PixmapRequest *req = m_request;
+    m_request = 0;
+    Okular::Page *page = req->page();
 
-    QPainter p( &image );
-    QRect r( 0, 0, m_request->width(), m_request->height() );
+    const PageLayout *previous = m_layouts.object( page->number() );
+    const bool replaceTextPage = !page->hasTextPage() || ( previous && !previous->complete );
 
-    bool moreToPaint;
-    m_syncGen->paint( &p, r, 0, &moreToPaint );
+    PageLayout *layout = recordLayout( m_syncGen, page, true );
+    additionalRequestData( page );
 
-    p.end();
+    m_syncGen->closeUrl();
+    m_chmUrl = QString();
+
+    if ( replaceTextPage )
+        page->setTextPage( createTextPage( layout, page ) );
 
-    if ( !m_textpageAddedList.at( m_request->pageNumber() ) ) {
-        additionalRequestData();
-        m_textpageAddedList[ m_request->pageNumber() ] = true;
+    // a layout bigger than the whole cache would be deleted right away by
+    // insert(), so it is only used for this request
+    const int cost = qMax( 1, int( layout->picture.size() / 1024 ) );
+    if ( cost > m_layouts.maxCost() )
+    {
+        m_layouts.remove( page->number() );
+        finishRequest( req, layout );
+        delete layout;
+        return;
     }
 
-    m_syncGen->closeUrl();
-    m_chmUrl = QString();
+    m_layouts.insert( page->number(), layout, cost );
+    finishRequest( req, layout );
+}
 
-    userMutex()->unlock();
+CHMGenerator::PageLayout *CHMGenerator::recordLayout( KHTMLPart *part, const Okular::Page *page, bool complete )
+{
+    PageLayout *layout = new PageLayout;
+    layout->complete = complete;
 
-    Okular::PixmapRequest *req = m_request;
-    m_request = 0;
+    if ( complete )
+    {
+        QPainter p( &layout->picture );
+        bool moreToPaint;
+        part->paint( &p, QRect( 0, 0, page->width(), page->height() ), 0, &moreToPaint );
+        p.end();
+    }
+
+    recursiveExploreNodes( part->htmlDocument(), &layout->text );
+
+    return layout;
+}
+
+Okular::TextPage *CHMGenerator::createTextPage( const PageLayout *layout, const Okular::Page *page ) const
+{
+    Okular::TextPage *tp = new Okular::TextPage();
+    for ( const QPair< QString, QRect > &entry : layout->text )
+        tp->append( entry.first, new Okular::NormalizedRect( entry.second, page->width(), page->height() ) );
+    return tp;
+}
+
+void CHMGenerator::finishRequest( Okular::PixmapRequest *request, const PageLayout *layout )
+{
+    QImage image( request->width(), request->height(), QImage::Format_ARGB32 );
+    image.fill( Qt::white );
+
+    QPainter p( &image );
+    p.scale( (qreal)request->width() / request->page()->width(), (qreal)request->height() / request->page()->height() );
+    p.drawPicture( 0, 0, layout->picture );
+    p.end();
 
-    if ( !req->page()->isBoundingBoxKnown() )
-        updatePageBoundingBox( req->page()->number(), Okular::Utils::imageBoundingBox( &image ) );
-    req->page()->setPixmap( req->observer(), new QPixmap( QPixmap::fromImage( image ) ) );
-    signalPixmapRequestDone( req );
+    if ( !request->page()->isBoundingBoxKnown() )
+        updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( &image ) );
+    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( image ) ) );
+    signalPixmapRequestDone( request );
 }
 
 Okular::DocumentInfo CHMGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
@@ -242,95 +289,55 @@ const Okular::DocumentSynopsis * CHMGenerator::generateDocumentSynopsis()
 
 bool CHMGenerator::canGeneratePixmap () const
 {
-    bool isLocked = true;
-    if ( userMutex()->tryLock() ) {
-        userMutex()->unlock();
-        isLocked = false;
-    }
-
-    return !isLocked;
+    // one page is laid out at a time
+    return !m_request;
 }
 
 void CHMGenerator::generatePixmap( Okular::PixmapRequest * request ) 
 {
-    int requestWidth = request->width();
-    int requestHeight = request->height();
+    const Okular::Page *page = request->page();
+
+    // a page laid out before only needs to be painted again
+    const PageLayout *layout = m_layouts.object( request->pageNumber() );
+    if ( layout && layout->complete )
+    {
+        finishRequest( request, layout );
+        return;
+    }
 
-    userMutex()->lock();
     QString url= m_pageUrl[request->pageNumber()];
 
     QString pAddress= QStringLiteral("ms-its:") + m_fileName + QStringLiteral("::") + m_file->urlToPath(QUrl(url));
     m_chmUrl = url;
-    m_syncGen->view()->resizeContents(requestWidth,requestHeight);
+    // the page is laid out at its own size, and scaled when painted
+    m_syncGen->view()->resize(page->width(), page->height());
     m_request=request;
-    // will emit openURL without problems
+    // will emit openURL without problems, the request is finished in slotCompleted()
     m_syncGen->openUrl ( QUrl(pAddress) );
 }
 
 
-void CHMGenerator::recursiveExploreNodes(DOM::Node node,Okular::TextPage *tp)
+void CHMGenerator::recursiveExploreNodes(DOM::Node node,QVector< QPair< QString, QRect > > *text)
 {
     if (node.nodeType() == DOM::Node::TEXT_NODE && !node.getRect().isNull())
     {
         QString nodeText=node.nodeValue().string();
         QRect r=node.getRect();
-        int vWidth=m_syncGen->view()->width();
-        int vHeight=m_syncGen->view()->height();
-        Okular::NormalizedRect *nodeNormRect;
-#define NOEXP
-#ifndef NOEXP
-        int x,y,height;
-        int x_next,y_next,height_next;
-        int nodeTextLength = nodeText.length();
-        if (nodeTextLength==1)
-        {
-            nodeNormRect=new Okular::NormalizedRect (r,vWidth,vHeight);
-            tp->append(nodeText,nodeNormRect,nodeNormRect->bottom,0,(nodeText=="\n"));
-        }
-        else
-        {
-            for (int i=0;i<nodeTextLength;i++)
-            { 
-                node.getCursor(i,x,y,height);
-                if (i==0)
-                // i is 0, use left rect boundary
-                {
-//                     if (nodeType[i+1]
-                    node.getCursor(i+1,x_next,y_next,height_next);
-                    nodeNormRect=new Okular::NormalizedRect (QRect(x,y,x_next-x-1,height),vWidth,vHeight);
-                }
-                else if ( i <nodeTextLength -1 )
-                // i is between zero and the last element
-                {
-                    node.getCursor(i+1,x_next,y_next,height_next);
-                    nodeNormRect=new Okular::NormalizedRect (QRect(x,y,x_next-x-1,height),vWidth,vHeight);
-                }
-                else
-                // the last element use right rect boundary
-                {
-                    node.getCursor(i-1,x_next,y_next,height_next);
-            }
-        }
-#else
-        nodeNormRect=new Okular::NormalizedRect (r,vWidth,vHeight);
-        tp->append(nodeText,nodeNormRect/*,0*/);
-#endif
+        text->append(qMakePair(nodeText,r));
     }
     DOM::Node child = node.firstChild();
     while ( !child.isNull() )
     {
-        recursiveExploreNodes(child,tp);
+        recursiveExploreNodes(child,text);
         child = child.nextSibling();
     }
 }
 
-void CHMGenerator::additionalRequestData() 
+void CHMGenerator::additionalRequestData( Okular::Page *page )
 {
-    Okular::Page * page=m_request->page();
-    const bool genObjectRects = !m_rectsGenerated.at( m_request->page()->number() );
-    const bool genTextPage = !m_request->page()->hasTextPage() && genObjectRects;
+    const bool genObjectRects = !m_rectsGenerated.at( page->number() );
 
-    if (genObjectRects || genTextPage )
+    if ( genObjectRects )
     {
         DOM::HTMLDocument domDoc=m_syncGen->htmlDocument();
         // only generate object info when generating a full page not a thumbnail
@@ -395,31 +402,45 @@ void CHMGenerator::additionalRequestData()
                     }
                 }
             }
-            m_request->page()->setObjectRects( objRects );
-            m_rectsGenerated[ m_request->page()->number() ] = true;
-        }
-
-        if ( genTextPage )
-        {
-            Okular::TextPage *tp=new Okular::TextPage();
-            recursiveExploreNodes(domDoc,tp);
-            page->setTextPage (tp);
+            page->setObjectRects( objRects );
+            m_rectsGenerated[ page->number() ] = true;
         }
     }
 }
 
 Okular::TextPage* CHMGenerator::textPage( Okular::TextRequest * request )
 {
-    userMutex()->lock();
-
     const Okular::Page *page = request->page();
-    m_syncGen->view()->resize(page->width(), page->height());
-    
-    preparePageForSyncOperation(m_pageUrl[page->number()]);
-    Okular::TextPage *tp=new Okular::TextPage();
-    recursiveExploreNodes( m_syncGen->htmlDocument(), tp);
-    userMutex()->unlock();
-    return tp;
+
+    const PageLayout *layout = m_layouts.object( page->number() );
+    if ( !layout )
+    {
+        // parse and lay out the page right away on a part of its own, so that
+        // the pixmap being generated is not disturbed; the text doesn't need
+        // to wait for the images and stylesheets of the page
+        if ( !m_textGen )
+            m_textGen = new KHTMLPart();
+
+        const QString url = m_pageUrl[page->number()];
+        QString html;
+        m_file->getFileContentAsString( html, QUrl( url ) );
+
+        m_textGen->view()->resize(page->width(), page->height());
+        m_textGen->begin( QUrl( QStringLiteral("ms-its:") + m_fileName + QStringLiteral("::") + m_file->urlToPath( QUrl( url ) ) ) );
+        m_textGen->write( html );
+        m_textGen->end();
+        m_textGen->view()->layout();
+
+        PageLayout *textLayout = recordLayout( m_textGen, page, false );
+        m_textGen->closeUrl();
+
+        // the layout may not survive insert(), use it first
+        Okular::TextPage *textPage = createTextPage( textLayout, page );
+        m_layouts.insert( page->number(), textLayout );
+        return textPage;
+    }
+
+    return createTextPage( layout, page );
 }
 
 QVariant CHMGenerator::metaData( const QString &key, const QVariant &option ) const
@@ -17,6 +17,8 @@
 #include "lib/ebook_chm.h"
 
 #include <qbitarray.h>
+#include <QCache>
+#include <QPicture>
 
 class KHTMLPart;
 
@@ -53,19 +55,35 @@ class CHMGenerator : public Okular::Generator
         Okular::TextPage* textPage( Okular::TextRequest *request ) override;
 
     private:
-        void additionalRequestData();
-        void recursiveExploreNodes( DOM::Node node, Okular::TextPage *tp );
+        /**
+         * The result of laying out a page: what it paints, at the size of
+         * the page, and its text. A layout done only to extract the text
+         * doesn't wait for images and stylesheets, and is not complete.
+         */
+        struct PageLayout
+        {
+            QPicture picture;
+            QVector< QPair< QString, QRect > > text;
+            bool complete;
+        };
+
+        void additionalRequestData( Okular::Page *page );
+        void recursiveExploreNodes( DOM::Node node, QVector< QPair< QString, QRect > > *text );
         void preparePageForSyncOperation( const QString &url );
+        PageLayout *recordLayout( KHTMLPart *part, const Okular::Page *page, bool complete );
+        Okular::TextPage *createTextPage( const PageLayout *layout, const Okular::Page *page ) const;
+        void finishRequest( Okular::PixmapRequest *request, const PageLayout *layout );
         QMap<QString, int> m_urlPage;
         QVector<QString> m_pageUrl;
         Okular::DocumentSynopsis m_docSyn;
         EBook* m_file;
         KHTMLPart *m_syncGen;
+        KHTMLPart *m_textGen;
         QString m_fileName;
         QString m_chmUrl;
         Okular::PixmapRequest* m_request;
-        QBitArray m_textpageAddedList;
         QBitArray m_rectsGenerated;
+        QCache< int, PageLayout > m_layouts;
 };
 
 #endif
@@ -9,9 +9,12 @@
 
 #include "document.h"
 
+#include <QBuffer>
 #include <QScopedPointer>
 #include <QImage>
 #include <QImageReader>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <KLocalizedString>
 #include <QMimeType>
@@ -42,6 +45,71 @@ static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir
     }
 }
 
+// amount of data read from archive entries to find out the size of their images
+static const int HeaderSize = 64 * 1024;
+
+namespace {
+
+struct PageProbe
+{
+    PageProbe()
+        : partial( false ), canRead( false ) {}
+
+    QString file;
+    // archive entries can't be read concurrently, only their first bytes are probed
+    bool partial;
+    QByteArray header;
+    bool canRead;
+    QSize size;
+};
+
+class PageSizeProbe : public QRunnable
+{
+    public:
+        PageSizeProbe( const Document *document, const Unrar *unrar, PageProbe *probe )
+            : mDocument( document ), mUnrar( unrar ), mProbe( probe )
+        {
+        }
+
+        void run() override
+        {
+            QScopedPointer< QIODevice > dev;
+            // rar entries are printed one by one by their own process, without extracting them
+            if ( mProbe->partial && mUnrar )
+                mProbe->header = mUnrar->header( mProbe->file, HeaderSize );
+
+            if ( mProbe->partial ) {
+                QBuffer *buffer = new QBuffer( &mProbe->header );
+                buffer->open( QIODevice::ReadOnly );
+                dev.reset( buffer );
+            } else {
+                dev.reset( mDocument->createDevice( mProbe->file ) );
+            }
+
+            if ( dev.isNull() )
+                return;
+
+            QImageReader reader( dev.data() );
+            if ( !reader.canRead() )
+                return;
+
+            mProbe->canRead = true;
+            mProbe->size = reader.size();
+            // a partial entry can't be decoded, it's done later from the whole one
+            if ( !mProbe->size.isValid() && !mProbe->partial ) {
+                const QImage i = reader.read();
+                if ( !i.isNull() )
+                    mProbe->size = i.size();
+            }
+        }
+
+    private:
+        const Document *mDocument;
+        const Unrar *mUnrar;
+        PageProbe *mProbe;
+};
+
+}
 
 Document::Document()
     : mDirectory( nullptr ), mUnrar( nullptr ), mArchive( nullptr )
@@ -164,45 +232,59 @@ bool Document::processArchive() {
 void Document::pages( QVector<Okular::Page*> * pagesVector )
 {
     qSort( mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen );
-    QScopedPointer< QIODevice > dev;
+
+    QVector< PageProbe > probes( mEntries.size() );
+    for ( int i = 0; i < mEntries.size(); ++i ) {
+        PageProbe &probe = probes[ i ];
+        probe.file = mEntries.at( i );
+        if ( mArchive ) {
+            QScopedPointer< QIODevice > dev( createDevice( probe.file ) );
+            probe.partial = true;
+            if ( !dev.isNull() )
+                probe.header = dev->read( HeaderSize );
+        } else if ( mUnrar ) {
+            probe.partial = true;
+        }
+    }
+
+    // probe the image headers concurrently
+    QThreadPool pool;
+    for ( int i = 0; i < probes.size(); ++i ) {
+        pool.start( new PageSizeProbe( this, mUnrar, &probes[ i ] ) );
+    }
+    pool.waitForDone();
 
     int count = 0;
     pagesVector->clear();
     pagesVector->resize( mEntries.size() );
-    QImageReader reader;
-    foreach(const QString &file, mEntries) {
-        if ( mArchive ) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
-            if ( entry ) {
-                dev.reset( entry->createDevice() );
+    foreach(const PageProbe &probe, probes) {
+        if ( !probe.canRead )
+            continue;
+
+        QSize pageSize = probe.size;
+        if ( !pageSize.isValid() && probe.partial ) {
+            // the header was not enough, decode the whole entry
+            QScopedPointer< QIODevice > dev( createDevice( probe.file ) );
+            if ( !dev.isNull() ) {
+                QImageReader reader( dev.data() );
+                const QImage i = reader.read();
+                if ( !i.isNull() )
+                    pageSize = i.size();
             }
-        } else if ( mDirectory ) {
-            dev.reset( mDirectory->createDevice( file ) );
-        } else {
-            dev.reset( mUnrar->createDevice( file ) );
         }
-
-        if ( ! dev.isNull() ) {
-            reader.setDevice( dev.data() );
-            if ( reader.canRead() )
-            {
-                QSize pageSize = reader.size();
-                if ( !pageSize.isValid() ) {
-                    const QImage i = reader.read();
-                    if ( !i.isNull() )
-                        pageSize = i.size();
-                }
-                if ( pageSize.isValid() ) {
-                    pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
-                    mPageMap.append(file);
-                    count++;
-                } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
-                }
-            }
+        if ( pageSize.isValid() ) {
+            pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
+            mPageMap.append(probe.file);
+            count++;
+        } else {
+            qCDebug(OkularComicbookDebug) << "Ignoring" << probe.file << "doesn't seem to be an image even if QImageReader::canRead returned true";
         }
     }
     pagesVector->resize( count );
+
+    // the pages are extracted ahead in the order they are read
+    if ( mUnrar )
+        mUnrar->setReadingOrder( mPageMap );
 }
 
 QStringList Document::pageTitles() const
@@ -210,19 +292,36 @@ QStringList Document::pageTitles() const
     return QStringList();
 }
 
-QImage Document::pageImage( int page ) const
+QImage Document::pageImage( int page, const QSize &size ) const
+{
+    QScopedPointer< QIODevice > dev( createDevice( mPageMap[ page ] ) );
+    if ( dev.isNull() )
+        return QImage();
+
+    QImageReader reader( dev.data() );
+    if ( size.isValid() ) {
+        // let the decoder skip the detail that would be scaled away anyway
+        const QSize imageSize = reader.size();
+        if ( imageSize.isValid() && size.width() * 2 <= imageSize.width() && size.height() * 2 <= imageSize.height() )
+            reader.setScaledSize( size );
+    }
+
+    return reader.read();
+}
+
+QIODevice* Document::createDevice( const QString &file ) const
 {
     if ( mArchive ) {
-        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( mPageMap[ page ] ) );
+        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
         if ( entry )
-            return QImage::fromData( entry->data() );
+            return entry->createDevice();
     } else if ( mDirectory ) {
-        return QImage( mPageMap[ page ] );
-    } else {
-        return QImage::fromData( mUnrar->contentOf( mPageMap[ page ] ) );
+        return mDirectory->createDevice( file );
+    } else if ( mUnrar ) {
+        return mUnrar->createDevice( file );
     }
 
-    return QImage();
+    return nullptr;
 }
 
 QString Document::lastErrorString() const
@@ -10,11 +10,13 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QSize>
 #include <QStringList>
 
 class KArchiveDirectory;
 class KArchive;
 class QImage;
+class QIODevice;
 class QSize;
 class Unrar;
 class Directory;
@@ -37,7 +39,18 @@ class Document
         void pages( QVector<Okular::Page*> * pagesVector );
         QStringList pageTitles() const;
 
-        QImage pageImage( int page ) const;
+        /**
+         * Returns the image of the given page. When @p size is valid and much
+         * smaller than the image, the decoder is asked to scale it down while
+         * decoding.
+         */
+        QImage pageImage( int page, const QSize &size = QSize() ) const;
+
+        /**
+         * Returns a new device for reading the given entry, it's up to the
+         * caller to delete it.
+         */
+        QIODevice* createDevice( const QString &file ) const;
 
         QString lastErrorString() const;
 
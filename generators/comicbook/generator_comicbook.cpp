@@ -61,7 +61,9 @@ QImage ComicBookGenerator::image( Okular::PixmapRequest * request )
     int width = request->width();
     int height = request->height();
 
-    QImage image = mDocument.pageImage( request->pageNumber() );
+    QImage image = mDocument.pageImage( request->pageNumber(), QSize( width, height ) );
+    if ( image.width() == width && image.height() == height )
+        return image;
 
     return image.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 }
@@ -15,6 +15,7 @@
 #include <QRegExp>
 #include <QGlobalStatic>
 #include <QTemporaryDir>
+#include <QThread>
 
 #include <QLoggingCategory>
 #if defined(WITH_KPTY)
@@ -24,6 +25,7 @@
 
 #include "debug_comicbook.h"
 
+#include <climits>
 #include <memory>
 #include <QStandardPaths>
 
@@ -104,13 +106,123 @@ UnrarHelper::~UnrarHelper()
 }
 
 
+// entries extracted in the background ahead of and behind the last read one
+static const int LookAheadEntries = 8;
+static const int LookBehindEntries = 2;
+// size of the extracted entries kept in the temporary directory, outside of the look ahead window
+static const qint64 MaxExtractedSize = 256 * 1024 * 1024;
+// time given to the unrar process to produce some output
+static const int ProcessTimeout = 30000;
+
+class LookAheadThread : public QThread
+{
+    public:
+        explicit LookAheadThread( Unrar *unrar )
+            : mUnrar( unrar )
+        {
+        }
+
+    protected:
+        void run() override
+        {
+            mUnrar->runLookAhead();
+        }
+
+    private:
+        Unrar *mUnrar;
+};
+
+// Reads a variable length integer of a RAR 5 header, returns false if it runs past the data
+static bool readRar5Number( const QByteArray &data, int *pos, quint64 *value )
+{
+    *value = 0;
+    for ( int shift = 0; *pos < data.size() && shift < 64; shift += 7 )
+    {
+        const uchar byte = data.at( (*pos)++ );
+        *value |= quint64( byte & 0x7f ) << shift;
+        if ( !( byte & 0x80 ) )
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Returns whether the files of the archive are compressed as one stream.
+ * Getting a file out of such an archive means decompressing all the ones
+ * before it, so they are better extracted all at once. Archives whose main
+ * header can't be read are considered solid.
+ */
+static bool isSolidArchive( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return true;
+
+    // self extracting archives have some code before the signature
+    const QByteArray data = file.read( 256 * 1024 );
+    static const char rar4Signature[] = "Rar!\x1a\x07\x00";
+    static const char rar5Signature[] = "Rar!\x1a\x07\x01\x00";
+
+    int pos = data.indexOf( QByteArray( rar5Signature, 8 ) );
+    if ( pos != -1 )
+    {
+        // main header: crc32, size, type, flags, [extra size], [data size], archive flags
+        quint64 size, type, flags, archiveFlags, skipped;
+        pos += 8 + 4;
+        if ( !readRar5Number( data, &pos, &size ) || !readRar5Number( data, &pos, &type ) || type != 1 ||
+             !readRar5Number( data, &pos, &flags ) )
+            return true;
+        if ( ( flags & 0x0001 ) && !readRar5Number( data, &pos, &skipped ) )
+            return true;
+        if ( ( flags & 0x0002 ) && !readRar5Number( data, &pos, &skipped ) )
+            return true;
+        if ( !readRar5Number( data, &pos, &archiveFlags ) )
+            return true;
+        return archiveFlags & 0x0004;
+    }
+
+    pos = data.indexOf( QByteArray( rar4Signature, 7 ) );
+    if ( pos != -1 )
+    {
+        // main header: crc16, type, flags
+        pos += 7;
+        if ( pos + 5 > data.size() || uchar( data.at( pos + 2 ) ) != 0x73 )
+            return true;
+        const int flags = uchar( data.at( pos + 3 ) ) | ( uchar( data.at( pos + 4 ) ) << 8 );
+        return flags & 0x0008;
+    }
+
+    return true;
+}
+
+static void startProcess( QProcess *process, const ProcessArgs &args )
+{
+    process->setStandardErrorFile( QProcess::nullDevice() );
+    // read only also closes the standard input, so that nothing waits for a password
+    if ( helper->kind->name() == QLatin1String( "unar" ) && args.useLsar )
+        process->start( helper->lsarPath, args.appArgs, QIODevice::ReadOnly );
+    else
+        process->start( helper->unrarPath, args.appArgs, QIODevice::ReadOnly );
+}
+
 Unrar::Unrar()
-    : QObject( nullptr ), mLoop( nullptr ), mTempDir( nullptr )
+    : QObject( nullptr ), mLoop( nullptr ), mTempDir( nullptr ), mStreaming( false ),
+      mReadingPosition( 0 ), mExtractedSize( 0 ), mStopLookAhead( false ), mLookAhead( nullptr )
 {
 }
 
 Unrar::~Unrar()
 {
+    if ( mLookAhead )
+    {
+        mMutex.lock();
+        mStopLookAhead = true;
+        mCondition.wakeAll();
+        mMutex.unlock();
+        mLookAhead->wait();
+        delete mLookAhead;
+    }
+
     delete mTempDir;
 }
 
@@ -124,12 +236,48 @@ bool Unrar::open( const QString &fileName )
 
     mFileName = fileName;
 
-    /**
-     * Extract the archive to a temporary directory
-     */
     mStdOutData.clear();
     mStdErrData.clear();
 
+    /**
+     * When the files can be printed one by one, only list them now and
+     * extract them on demand. Not for solid archives, where printing a file
+     * decompresses all the ones before it, and probing every page when
+     * opening would decompress the archive over and over
+     */
+    mStreaming = !helper->kind->processPrintArgs( mFileName, QString() ).appArgs.isEmpty() && !isSolidArchive( mFileName );
+    if ( mStreaming )
+    {
+        startSyncProcess( helper->kind->processListArgs( mFileName ) );
+
+        const QStringList listFiles = helper->kind->processListing( QString::fromLocal8Bit( mStdOutData ).split( QLatin1Char('\n'), QString::SkipEmptyParts ) );
+        Q_FOREACH ( const QString &f, listFiles ) {
+            // directories listed by the unarchiver
+            if ( f.endsWith( QLatin1Char('/') ) || mEntries.contains( f ) )
+                continue;
+
+            Entry entry;
+            entry.id = mListing.count();
+            entry.readingIndex = mListing.count();
+            entry.state = Entry::NotExtracted;
+            entry.size = 0;
+            mEntries.insert( f, entry );
+            mListing.append( f );
+        }
+
+        if ( mListing.isEmpty() )
+            return false;
+
+        mReadingOrder = mListing;
+        mLookAhead = new LookAheadThread( this );
+        mLookAhead->start( QThread::LowPriority );
+
+        return true;
+    }
+
+    /**
+     * Extract the archive to a temporary directory
+     */
     const int ret = startSyncProcess( helper->kind->processOpenArchiveArgs( mFileName, mTempDir->path() ) );
     bool ok = ret == 0;
 
@@ -138,6 +286,9 @@ bool Unrar::open( const QString &fileName )
 
 QStringList Unrar::list()
 {
+    if ( mStreaming )
+        return mListing;
+
     mStdOutData.clear();
     mStdErrData.clear();
 
@@ -173,7 +324,11 @@ QByteArray Unrar::contentOf( const QString &fileName ) const
     if ( !isSuitableVersionAvailable() )
         return QByteArray();
 
-    QFile file( mTempDir->path() + QLatin1Char('/') + fileName );
+    const QString path = mStreaming ? extractedPath( fileName ) : mTempDir->path() + QLatin1Char('/') + fileName;
+    if ( path.isEmpty() )
+        return QByteArray();
+
+    QFile file( path );
     if ( !file.open( QIODevice::ReadOnly ) )
         return QByteArray();
 
@@ -185,13 +340,240 @@ QIODevice* Unrar::createDevice( const QString &fileName ) const
     if ( !isSuitableVersionAvailable() )
         return nullptr;
 
-    std::unique_ptr< QFile> file( new QFile( mTempDir->path() + QLatin1Char('/') + fileName ) );
+    const QString path = mStreaming ? extractedPath( fileName ) : mTempDir->path() + QLatin1Char('/') + fileName;
+    if ( path.isEmpty() )
+        return nullptr;
+
+    std::unique_ptr< QFile> file( new QFile( path ) );
     if ( !file->open( QIODevice::ReadOnly ) )
         return nullptr;
 
     return file.release();
 }
 
+QByteArray Unrar::header( const QString &fileName, int size ) const
+{
+    if ( !isSuitableVersionAvailable() )
+        return QByteArray();
+
+    QString path;
+    if ( !mStreaming )
+    {
+        path = mTempDir->path() + QLatin1Char('/') + fileName;
+    }
+    else
+    {
+        QMutexLocker locker( &mMutex );
+        QHash< QString, Entry >::const_iterator it = mEntries.constFind( fileName );
+        if ( it == mEntries.constEnd() )
+            return QByteArray();
+        if ( it->state == Entry::Extracted )
+            path = entryPath( *it );
+    }
+
+    if ( !path.isEmpty() )
+    {
+        QFile file( path );
+        if ( !file.open( QIODevice::ReadOnly ) )
+            return QByteArray();
+
+        return file.read( size );
+    }
+
+    // print the file, stopping as soon as we have enough of it
+    QProcess process;
+    startProcess( &process, helper->kind->processPrintArgs( mFileName, fileName ) );
+
+    QByteArray data;
+    while ( data.size() < size )
+    {
+        if ( process.bytesAvailable() == 0 && !process.waitForReadyRead( ProcessTimeout ) )
+            break;
+        data += process.read( size - data.size() );
+    }
+    if ( data.size() < size )
+        data += process.read( size - data.size() );
+
+    process.kill();
+    process.waitForFinished( ProcessTimeout );
+
+    return data;
+}
+
+void Unrar::setReadingOrder( const QStringList &fileNames )
+{
+    if ( !mStreaming )
+        return;
+
+    QMutexLocker locker( &mMutex );
+    mReadingOrder.clear();
+    for ( QHash< QString, Entry >::iterator it = mEntries.begin(), end = mEntries.end(); it != end; ++it )
+        it->readingIndex = -1;
+
+    Q_FOREACH ( const QString &f, fileNames )
+    {
+        QHash< QString, Entry >::iterator it = mEntries.find( f );
+        if ( it == mEntries.end() || it->readingIndex != -1 )
+            continue;
+
+        it->readingIndex = mReadingOrder.count();
+        mReadingOrder.append( f );
+    }
+
+    mReadingPosition = 0;
+    mCondition.wakeAll();
+}
+
+QString Unrar::entryPath( const Entry &entry ) const
+{
+    return mTempDir->path() + QLatin1Char('/') + QString::number( entry.id );
+}
+
+QString Unrar::extractedPath( const QString &fileName ) const
+{
+    QMutexLocker locker( &mMutex );
+
+    QHash< QString, Entry >::iterator it = mEntries.find( fileName );
+    if ( it == mEntries.end() )
+        return QString();
+
+    // the look ahead follows the reader
+    if ( it->readingIndex != -1 && it->readingIndex != mReadingPosition )
+    {
+        mReadingPosition = it->readingIndex;
+        mCondition.wakeAll();
+    }
+
+    while ( it->state == Entry::Extracting )
+        mCondition.wait( &mMutex );
+
+    if ( it->state == Entry::NotExtracted )
+        extractEntry( fileName );
+
+    return it->state == Entry::Extracted ? entryPath( *it ) : QString();
+}
+
+bool Unrar::extractEntry( const QString &fileName ) const
+{
+    // called and returning with mMutex locked, the entries are never added
+    // or removed after opening so the reference stays valid
+    Entry &entry = mEntries[ fileName ];
+    entry.state = Entry::Extracting;
+    const QString path = entryPath( entry );
+
+    mMutex.unlock();
+    const bool ok = printEntry( fileName, path );
+    mMutex.lock();
+
+    if ( ok )
+    {
+        entry.state = Entry::Extracted;
+        entry.size = QFileInfo( path ).size();
+        mExtractedSize += entry.size;
+        evictEntries();
+    }
+    else
+    {
+        qCWarning(OkularComicbookDebug) << "Could not extract" << fileName;
+        entry.state = Entry::Failed;
+    }
+    mCondition.wakeAll();
+
+    return ok;
+}
+
+bool Unrar::printEntry( const QString &fileName, const QString &destination ) const
+{
+    // write to a temporary name, so that no partial file ever has the final one
+    const QString partialDestination = destination + QStringLiteral(".part");
+    QFile file( partialDestination );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    QProcess process;
+    startProcess( &process, helper->kind->processPrintArgs( mFileName, fileName ) );
+
+    forever
+    {
+        if ( process.bytesAvailable() == 0 && !process.waitForReadyRead( ProcessTimeout ) )
+            break;
+        file.write( process.readAll() );
+    }
+    process.waitForFinished( ProcessTimeout );
+    file.write( process.readAll() );
+    file.close();
+
+    const bool ok = process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0 && file.size() > 0;
+    if ( !ok || !QFile::rename( partialDestination, destination ) )
+    {
+        QFile::remove( partialDestination );
+        return false;
+    }
+
+    return true;
+}
+
+void Unrar::evictEntries() const
+{
+    // called with mMutex locked
+    while ( mExtractedSize > MaxExtractedSize )
+    {
+        // remove the extracted entry farthest from the reading position,
+        // never touching the look ahead window
+        QHash< QString, Entry >::iterator farthest = mEntries.end();
+        int farthestDistance = 0;
+        for ( QHash< QString, Entry >::iterator it = mEntries.begin(), end = mEntries.end(); it != end; ++it )
+        {
+            if ( it->state != Entry::Extracted )
+                continue;
+
+            const int distance = it->readingIndex == -1 ? INT_MAX : qAbs( it->readingIndex - mReadingPosition );
+            if ( it->readingIndex != -1 && it->readingIndex >= mReadingPosition - LookBehindEntries &&
+                 it->readingIndex <= mReadingPosition + LookAheadEntries )
+                continue;
+
+            if ( distance > farthestDistance )
+            {
+                farthest = it;
+                farthestDistance = distance;
+            }
+        }
+
+        if ( farthest == mEntries.end() )
+            break;
+
+        QFile::remove( entryPath( *farthest ) );
+        mExtractedSize -= farthest->size;
+        farthest->state = Entry::NotExtracted;
+        farthest->size = 0;
+    }
+}
+
+void Unrar::runLookAhead()
+{
+    QMutexLocker locker( &mMutex );
+
+    while ( !mStopLookAhead )
+    {
+        // the next entries in reading order first, then the previous ones
+        QString next;
+        for ( int i = 0; i <= LookAheadEntries + LookBehindEntries && next.isEmpty(); ++i )
+        {
+            const int index = i <= LookAheadEntries ? mReadingPosition + i : mReadingPosition + LookAheadEntries - i;
+            if ( index < 0 || index >= mReadingOrder.count() )
+                continue;
+
+            if ( mEntries.value( mReadingOrder.at( index ) ).state == Entry::NotExtracted )
+                next = mReadingOrder.at( index );
+        }
+
+        if ( next.isEmpty() )
+            mCondition.wait( &mMutex );
+        else
+            extractEntry( next );
+    }
+}
+
 bool Unrar::isAvailable()
 {
     return helper->kind;
@@ -10,14 +10,18 @@
 #ifndef UNRAR_H
 #define UNRAR_H
 
+#include <QHash>
+#include <QMutex>
 #include <QObject>
 #include <QProcess>
 #include <QStringList>
+#include <QWaitCondition>
 
 #include <unrarflavours.h>
 
 class QEventLoop;
 class QTemporaryDir;
+class LookAheadThread;
 
 #if defined(WITH_KPTY)
 class KPtyProcess;
@@ -58,6 +62,18 @@ class Unrar : public QObject
          */
         QIODevice* createDevice( const QString &fileName ) const;
 
+        /**
+         * Returns the first @p size bytes of the file with the given name,
+         * without extracting the whole file when possible.
+         */
+        QByteArray header( const QString &fileName, int size ) const;
+
+        /**
+         * Sets the order in which the files are going to be read, files are
+         * extracted in the background following it.
+         */
+        void setReadingOrder( const QStringList &fileNames );
+
         static bool isAvailable();
         static bool isSuitableVersionAvailable();
 
@@ -67,9 +83,31 @@ class Unrar : public QObject
         void finished( int exitCode, QProcess::ExitStatus exitStatus );
 
     private:
+        friend class LookAheadThread;
+
+        /**
+         * A file of the archive, when the files are extracted on demand.
+         */
+        struct Entry
+        {
+            enum State { NotExtracted, Extracting, Extracted, Failed };
+
+            int id;
+            int readingIndex;
+            State state;
+            qint64 size;
+        };
+
         int startSyncProcess( const ProcessArgs &args );
         void writeToProcess( const QByteArray &data );
 
+        QString extractedPath( const QString &fileName ) const;
+        QString entryPath( const Entry &entry ) const;
+        bool extractEntry( const QString &fileName ) const;
+        bool printEntry( const QString &fileName, const QString &destination ) const;
+        void evictEntries() const;
+        void runLookAhead();
+
 #if defined(WITH_KPTY)
         KPtyProcess *mProcess;
 #else
@@ -80,6 +118,19 @@ class Unrar : public QObject
         QByteArray mStdOutData;
         QByteArray mStdErrData;
         QTemporaryDir *mTempDir;
+
+        // whether the files are extracted on demand instead of when opening
+        bool mStreaming;
+        QStringList mListing;
+        QStringList mReadingOrder;
+        // the following are guarded by mMutex
+        mutable QMutex mMutex;
+        mutable QWaitCondition mCondition;
+        mutable QHash< QString, Entry > mEntries;
+        mutable int mReadingPosition;
+        mutable qint64 mExtractedSize;
+        bool mStopLookAhead;
+        LookAheadThread *mLookAhead;
 };
 
 #endif
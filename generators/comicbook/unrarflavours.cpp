@@ -67,6 +67,11 @@ ProcessArgs NonFreeUnrarFlavour::processOpenArchiveArgs( const QString &fileName
     return ProcessArgs ( QStringList() << QStringLiteral("e") << fileName << path +  QLatin1Char('/'), false );
 }
 
+ProcessArgs NonFreeUnrarFlavour::processPrintArgs( const QString &fileName, const QString &entry ) const
+{
+    return ProcessArgs ( QStringList() << QStringLiteral("p") << QStringLiteral("-inul") << QStringLiteral("-p-") << QStringLiteral("--") << fileName << entry, false );
+}
+
 FreeUnrarFlavour::FreeUnrarFlavour()
     : UnrarFlavour()
 {
@@ -100,6 +105,11 @@ ProcessArgs FreeUnrarFlavour::processOpenArchiveArgs( const QString&, const QStr
     return ProcessArgs();
 }
 
+ProcessArgs FreeUnrarFlavour::processPrintArgs( const QString&, const QString& ) const
+{
+    return ProcessArgs();
+}
+
 UnarFlavour::UnarFlavour()
     : UnrarFlavour()
 {
@@ -129,3 +139,8 @@ ProcessArgs UnarFlavour::processOpenArchiveArgs( const QString &fileName, const
     return ProcessArgs ( QStringList() << fileName << QStringLiteral("-o") << path +  QLatin1Char('/'), false );
 }
 
+ProcessArgs UnarFlavour::processPrintArgs( const QString &fileName, const QString &entry ) const
+{
+    return ProcessArgs ( QStringList() << QStringLiteral("-q") << QStringLiteral("-o") << QStringLiteral("-") << fileName << entry, false );
+}
+
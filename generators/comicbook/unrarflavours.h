@@ -34,6 +34,11 @@ class UnrarFlavour
 
         virtual ProcessArgs processListArgs( const QString &fileName ) const = 0;
         virtual ProcessArgs processOpenArchiveArgs( const QString &fileName, const QString &path ) const = 0;
+        /**
+         * Returns the arguments to print the content of @p entry on the standard output,
+         * or empty arguments if the flavour can't do that.
+         */
+        virtual ProcessArgs processPrintArgs( const QString &fileName, const QString &entry ) const = 0;
 
         void setFileName( const QString &fileName );
 
@@ -56,6 +61,7 @@ class NonFreeUnrarFlavour : public UnrarFlavour
 
         ProcessArgs processListArgs( const QString &fileName ) const override;
         ProcessArgs processOpenArchiveArgs( const QString &fileName, const QString &path ) const override;
+        ProcessArgs processPrintArgs( const QString &fileName, const QString &entry ) const override;
 };
 
 class FreeUnrarFlavour : public UnrarFlavour
@@ -68,6 +74,7 @@ class FreeUnrarFlavour : public UnrarFlavour
 
         ProcessArgs processListArgs( const QString &fileName ) const override;
         ProcessArgs processOpenArchiveArgs( const QString &fileName, const QString &path ) const override;
+        ProcessArgs processPrintArgs( const QString &fileName, const QString &entry ) const override;
 };
 
 class UnarFlavour : public UnrarFlavour
@@ -80,6 +87,7 @@ class UnarFlavour : public UnrarFlavour
 
         ProcessArgs processListArgs( const QString &fileName ) const override;
         ProcessArgs processOpenArchiveArgs( const QString &fileName, const QString &path ) const override;
+        ProcessArgs processPrintArgs( const QString &fileName, const QString &entry ) const override;
 };
 
 #endif
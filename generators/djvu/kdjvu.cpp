@@ -10,6 +10,7 @@
 #include "kdjvu.h"
 
 #include <QByteArray>
+#include <QCache>
 #include <QDomDocument>
 #include <QFile>
 #include <QHash>
@@ -143,20 +144,61 @@ static bool find_replace_or_add_second_in_pair( miniexp_t theexp, const char* wh
     return false;
 }
 
-// ImageCacheItem
+// ImageCacheKey
 
-class ImageCacheItem
+struct ImageCacheKey
+{
+    ImageCacheKey( int p, int w, int h, int r )
+      : page( p ), width( w ), height( h ), rotation( r ) { }
+
+    bool operator==( const ImageCacheKey &other ) const
+    {
+        return page == other.page && width == other.width && height == other.height && rotation == other.rotation;
+    }
+
+    int page;
+    int width;
+    int height;
+    int rotation;
+};
+
+inline uint qHash( const ImageCacheKey &key, uint seed = 0 )
+{
+    return qHash( key.page, seed ) ^ qHash( ( key.width << 16 ) ^ key.height, seed ) ^ uint( key.rotation );
+}
+
+// PageHandle
+
+/**
+ * Owns a djvulibre page, which is decoded by the djvulibre threads
+ * from its creation on.
+ */
+class PageHandle
 {
     public:
-        ImageCacheItem( int p, int w, int h, const QImage& i )
-          : page( p ), width( w ), height( h ), img( i ) { }
+        explicit PageHandle( ddjvu_page_t *p )
+          : page( p ) { }
+
+        ~PageHandle()
+        {
+            ddjvu_page_release( page );
+        }
+
+        ddjvu_page_t *page;
 
-        int page;
-        int width;
-        int height;
-        QImage img;
+    private:
+        Q_DISABLE_COPY( PageHandle )
 };
 
+// maximum number of rendered images kept, when the cache is enabled
+static const int MaxCachedImages = 10;
+// rough memory budget of the decoded pages, in KiB; a decoded page takes
+// about a byte per pixel of its full resolution
+static const int MaxPageHandlesCost = 128 * 1024;
+// pages decoded ahead of and behind the last rendered one
+static const int PrefetchAhead = 2;
+static const int PrefetchBehind = 1;
+
 
 // KdjVu::Page
 
@@ -430,10 +472,13 @@ class KDjVu::Private
     public:
         Private()
           : m_djvu_cxt( nullptr ), m_djvu_document( nullptr ), m_format( nullptr ), m_docBookmarks( nullptr ),
-            m_cacheEnabled( true )
+            m_pageHandles( MaxPageHandlesCost ), m_imgCache( MaxCachedImages ), m_cacheEnabled( true )
         {
         }
 
+        PageHandle *pageHandle( int page );
+        void prefetchPages( int page );
+
         QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
             int width, int row, int xdelta, int height, int col, int ydelta );
 
@@ -450,9 +495,9 @@ class KDjVu::Private
         ddjvu_format_t *m_format;
 
         QVector<KDjVu::Page*> m_pages;
-        QVector<ddjvu_page_t *> m_pages_cache;
+        QCache<int, PageHandle> m_pageHandles;
 
-        QList<ImageCacheItem*> mImgCache;
+        QCache<ImageCacheKey, QImage> m_imgCache;
 
         QHash<QString, QVariant> m_metaData;
         QDomDocument * m_docBookmarks;
@@ -466,6 +511,36 @@ class KDjVu::Private
 
 unsigned int KDjVu::Private::s_formatmask[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
+PageHandle *KDjVu::Private::pageHandle( int page )
+{
+    PageHandle *handle = m_pageHandles.object( page );
+    if ( handle )
+        return handle;
+
+    ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( m_djvu_document, page );
+    if ( !newpage )
+        return nullptr;
+
+    handle = new PageHandle( newpage );
+    const KDjVu::Page *p = m_pages.at( page );
+    // a page larger than the whole budget is still kept, alone
+    const int cost = qBound( 1, int( qint64( p->width() ) * p->height() / 1024 ), m_pageHandles.maxCost() );
+    m_pageHandles.insert( page, handle, cost );
+    return handle;
+}
+
+void KDjVu::Private::prefetchPages( int page )
+{
+    // creating the pages is enough to get them decoded by djvulibre in the background,
+    // touching the current page last keeps it the most recently used one
+    for ( int i = qMax( 0, page - PrefetchBehind ); i <= qMin( m_pages.count() - 1, page + PrefetchAhead ); ++i )
+    {
+        if ( i != page )
+            pageHandle( i );
+    }
+    m_pageHandles.object( page );
+}
+
 QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
     int width, int row, int xdelta, int height, int col, int ydelta )
 {
@@ -686,8 +761,6 @@ bool KDjVu::openFile( const QString & fileName )
     int numofpages = ddjvu_document_get_pagenum( d->m_djvu_document );
     d->m_pages.clear();
     d->m_pages.resize( numofpages );
-    d->m_pages_cache.clear();
-    d->m_pages_cache.resize( numofpages );
 
     // get the document type
     QString doctype;
@@ -758,13 +831,9 @@ void KDjVu::closeFile()
     qDeleteAll( d->m_pages );
     d->m_pages.clear();
     // releasing the djvu pages
-    QVector<ddjvu_page_t *>::Iterator it = d->m_pages_cache.begin(), itEnd = d->m_pages_cache.end();
-    for ( ; it != itEnd; ++it )
-        ddjvu_page_release( *it );
-    d->m_pages_cache.clear();
+    d->m_pageHandles.clear();
     // clearing the image cache
-    qDeleteAll( d->mImgCache );
-    d->mImgCache.clear();
+    d->m_imgCache.clear();
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaing the page names mapping
@@ -911,41 +980,22 @@ const QVector<KDjVu::Page*> &KDjVu::pages() const
 
 QImage KDjVu::image( int page, int width, int height, int rotation )
 {
+    const ImageCacheKey key( page, width, height, rotation );
     if ( d->m_cacheEnabled )
     {
-        bool found = false;
-        QList<ImageCacheItem*>::Iterator it = d->mImgCache.begin(), itEnd = d->mImgCache.end();
-        for ( ; ( it != itEnd ) && !found; ++it )
-        {
-            ImageCacheItem* cur = *it;
-            if ( ( cur->page == page ) &&
-                ( rotation % 2 == 0
-                ? cur->width == width && cur->height == height
-                : cur->width == height && cur->height == width ) )
-                found = true;
-        }
-        if ( found )
-        {
-            // taking the element and pushing to the top of the list
-            --it;
-            ImageCacheItem* cur2 = *it;
-            d->mImgCache.erase( it );
-            d->mImgCache.push_front( cur2 );
-
-            return cur2->img;
-        }
+        const QImage *cached = d->m_imgCache.object( key );
+        if ( cached )
+            return *cached;
     }
 
-    if ( !d->m_pages_cache.at( page ) )
-    {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( d->m_djvu_document, page );
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    PageHandle *handle = d->pageHandle( page );
+    if ( !handle )
+        return QImage();
+    ddjvu_page_t *djvupage = handle->page;
+
+    // wait for the page to be decoded, unless it already was in the background
+    while ( ddjvu_page_decoding_status( djvupage ) < DDJVU_JOB_OK )
+        handle_ddjvu_messages( d->m_djvu_cxt, true );
 
 /*
     if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
@@ -1002,30 +1052,20 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
         int imgsize = newimg.width() * newimg.height();
         if ( imgsize > 0 )
         {
-            for( int i = 0; i < d->mImgCache.count(); )
+            Q_FOREACH ( const ImageCacheKey &cur, d->m_imgCache.keys() )
             {
-                ImageCacheItem* cur = d->mImgCache.at(i);
-                if ( ( cur->page == page ) &&
-                     ( abs( cur->img.width() * cur->img.height() - imgsize ) < imgsize * 0.35 ) )
-                {
-                    d->mImgCache.removeAt( i );
-                    delete cur;
-                }
-                else
-                    ++i;
+                if ( ( cur.page == page ) &&
+                     ( abs( cur.width * cur.height - imgsize ) < imgsize * 0.35 ) )
+                    d->m_imgCache.remove( cur );
             }
         }
 
-        // the image cache has too many elements, remove the last
-        if ( d->mImgCache.size() >= 10 )
-        {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
-        }
-        ImageCacheItem* ich = new ImageCacheItem( page, width, height, newimg );
-        d->mImgCache.push_front( ich );
+        // the least recently used image goes away when the cache is full
+        d->m_imgCache.insert( key, new QImage( newimg ) );
     }
 
+    d->prefetchPages( page );
+
     return newimg;
 }
 
@@ -1143,8 +1183,7 @@ void KDjVu::setCacheEnabled( bool enable )
     d->m_cacheEnabled = enable;
     if ( !d->m_cacheEnabled )
     {
-        qDeleteAll( d->mImgCache );
-        d->mImgCache.clear();
+        d->m_imgCache.clear();
     }
 }
 
@@ -2,7 +2,39 @@
 #include <config.h>
 
 #include "TeXFont.h"
+#include "fontpool.h"
 
 
 TeXFont::~TeXFont()
-{}
+{
+  parent->font_pool->removeFromGlyphCache(this);
+}
+
+
+bool TeXFont::loadShrunkenCharacter(quint16 ch, const QColor& color)
+{
+  const shrunkenGlyphKey key(this, ch, qRound(parent->displayResolution_in_dpi), color.rgba());
+  const shrunkenGlyph *cached = parent->font_pool->glyphCache.object(key);
+  if (cached == nullptr)
+    return false;
+
+  glyph *g = glyphtable+ch;
+  g->shrunkenCharacter = cached->image;
+  g->x2 = cached->x2;
+  g->y2 = cached->y2;
+  g->color = color;
+  return true;
+}
+
+
+void TeXFont::storeShrunkenCharacter(quint16 ch)
+{
+  const glyph *g = glyphtable+ch;
+  const shrunkenGlyphKey key(this, ch, qRound(parent->displayResolution_in_dpi), g->color.rgba());
+
+  shrunkenGlyph *cached = new shrunkenGlyph;
+  cached->image = g->shrunkenCharacter;
+  cached->x2 = g->x2;
+  cached->y2 = g->y2;
+  parent->font_pool->glyphCache.insert(key, cached, qMax(1, g->shrunkenCharacter.bytesPerLine() * g->shrunkenCharacter.height()));
+}
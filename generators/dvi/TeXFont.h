@@ -41,6 +41,15 @@ class TeXFont {
   QString            errorMessage;
 
  protected:
+  // Fetches the shrunken character ch, at the current resolution and in
+  // the given color, from the glyph cache of the font pool. Returns
+  // false if it isn't there and needs to be generated.
+  bool loadShrunkenCharacter(quint16 ch, const QColor& color);
+
+  // Puts the shrunken character ch, which was just generated, into the
+  // glyph cache of the font pool.
+  void storeShrunkenCharacter(quint16 ch);
+
   glyph              glyphtable[TeXFontDefinition::max_num_of_chars_in_font];
   TeXFontDefinition *parent;
 };
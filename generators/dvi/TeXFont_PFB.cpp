@@ -157,7 +157,8 @@ glyph* TeXFont_PFB::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCo
   if (fatalErrorInFontLoading == true)
     return g;
 
-  if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) ) {
+  if ((generateCharacterPixmap == true) && ((g->shrunkenCharacter.isNull()) || (color != g->color)) &&
+      !loadShrunkenCharacter(ch, color)) {
     int error;
     unsigned int res =  (unsigned int)(parent->displayResolution_in_dpi/parent->enlargement +0.5);
     g->color = color;
@@ -271,6 +272,7 @@ glyph* TeXFont_PFB::getGlyph(quint16 ch, bool generateCharacterPixmap, const QCo
       g->shrunkenCharacter = imgi;
       g->x2 = -slot->bitmap_left;
       g->y2 = slot->bitmap_top;
+      storeShrunkenCharacter(ch);
     }
   }
 
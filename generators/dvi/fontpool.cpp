@@ -33,7 +33,11 @@ QTime fontPoolTimer;
 bool fontPoolTimerFlag;
 #endif
 
+// Memory used by the glyph cache, in bytes
+static const int glyphCacheSize = 32 * 1024 * 1024;
+
 fontPool::fontPool(bool useFontHinting)
+  : glyphCache(glyphCacheSize)
 {
 #ifdef DEBUG_FONTPOOL
   qCDebug(OkularDviDebug) << "fontPool::fontPool() called";
@@ -107,6 +111,7 @@ void fontPool::setParameters( bool _useFontHints )
 {
   // Check if glyphs need to be cleared
   if (_useFontHints != useFontHints) {
+    glyphCache.clear();
     double displayResolution = displayResolution_in_dpi;
     QList<TeXFontDefinition*>::iterator it_fontp = fontList.begin();
     for (; it_fontp != fontList.end(); ++it_fontp) {
@@ -365,6 +370,15 @@ void fontPool::setCMperDVIunit( double _CMperDVI )
 }
 
 
+void fontPool::removeFromGlyphCache(const TeXFont *font)
+{
+  const QList<shrunkenGlyphKey> keys = glyphCache.keys();
+  for (const shrunkenGlyphKey &key : keys)
+    if (key.font == font)
+      glyphCache.remove(key);
+}
+
+
 void fontPool::setDisplayResolution( double _displayResolution_in_dpi )
 {
 #ifdef DEBUG_FONTPOOL
@@ -11,6 +11,8 @@
 #include "fontMap.h"
 #include "TeXFontDefinition.h"
 
+#include <QCache>
+#include <QImage>
 #include <QList>
 #include <QObject>
 #include <QProcess>
@@ -21,6 +23,36 @@
 #endif
 
 
+/** Identifies a shrunken character in the glyph cache of the font
+    pool. The resolution is rounded to whole DPIs, which is below the
+    changes of resolution the renderer cares about anyway. */
+struct shrunkenGlyphKey {
+  shrunkenGlyphKey(const TeXFont *_font, quint16 _ch, int _resolution, QRgb _color)
+    : font(_font), ch(_ch), resolution(_resolution), color(_color) {}
+
+  bool operator==(const shrunkenGlyphKey &other) const
+    {
+      return font == other.font && ch == other.ch && resolution == other.resolution && color == other.color;
+    }
+
+  const TeXFont *font;
+  quint16 ch;
+  int resolution;
+  QRgb color;
+};
+
+inline uint qHash(const shrunkenGlyphKey &key, uint seed = 0)
+{
+  return qHash(key.font, seed) ^ qHash((key.resolution << 16) | key.ch, seed) ^ key.color;
+}
+
+/** A shrunken character, with the offsets of its hot point */
+struct shrunkenGlyph {
+  QImage image;
+  short x2, y2;
+};
+
+
 /**
  *  A list of fonts and a compilation of utility functions
  *
@@ -122,6 +154,16 @@ public:
       drawing routines for the different setups. */
   bool QPixmapSupportsAlpha;
 
+  /** The shrunken characters of all the fonts, at all the resolutions
+      that were recently rendered. Keeping them here instead of only
+      in the fonts, which hold those of the current resolution, avoids
+      shrinking the same glyphs again and again when pages and
+      thumbnails are rendered in turn. The cost is in bytes. */
+  QCache<shrunkenGlyphKey, shrunkenGlyph> glyphCache;
+
+  /** Removes the shrunken characters of the font from the glyph cache */
+  void removeFromGlyphCache(const TeXFont *font);
+
 Q_SIGNALS:
   /** Passed through to the top-level kpart. */
   void error( const QString &message, int duration );
@@ -229,12 +229,11 @@ QTextDocument* Converter::convert( const QString &fileName )
               QString lnk = images.at(i).toElement().attribute(QStringLiteral("xlink:href"));
               int ht = images.at(i).toElement().attribute(QStringLiteral("height")).toInt();
               int wd = images.at(i).toElement().attribute(QStringLiteral("width")).toInt();
-              QImage img = mTextDocument->loadResource(QTextDocument::ImageResource,QUrl(lnk)).value<QImage>();
-              if(ht == 0) ht = img.height();
-              if(wd == 0) wd = img.width();
+              const QSize imgSize = mTextDocument->imageSize(QUrl(lnk));
+              if(ht == 0) ht = imgSize.height();
+              if(wd == 0) wd = imgSize.width();
               if(ht > maxHeight) ht = maxHeight;
               if(wd > maxWidth) wd = maxWidth;
-              mTextDocument->addResource(QTextDocument::ImageResource,QUrl(lnk),img);
               QDomDocument newDoc;
               newDoc.setContent(QStringLiteral("<img src=\"%1\" height=\"%2\" width=\"%3\" />").arg(lnk).arg(ht).arg(wd));
               imgNodes.append(newDoc.documentElement());
@@ -245,6 +244,36 @@ QTextDocument* Converter::convert( const QString &fileName )
           }
         }
 
+        // give every image its size up front, so that laying out the chapter
+        // does not decode it; the pixels are only loaded when the page is painted
+        QDomNodeList imgs = dom.elementsByTagName(QStringLiteral("img"));
+        for (int i = 0; i < imgs.length(); ++i) {
+          QDomElement img = imgs.at(i).toElement();
+          // images are loaded when painted, by then another chapter is the
+          // current sub document: point them to their file in the archive now
+          const QUrl src = mTextDocument->resolveUrl(QUrl(img.attribute(QStringLiteral("src"))));
+          img.setAttribute(QStringLiteral("src"), src.toString());
+          bool htOk = false, wdOk = false;
+          const int ht = img.attribute(QStringLiteral("height")).toInt(&htOk);
+          const int wd = img.attribute(QStringLiteral("width")).toInt(&wdOk);
+          const bool hasHt = img.hasAttribute(QStringLiteral("height"));
+          const bool hasWd = img.hasAttribute(QStringLiteral("width"));
+          // leave alone what we cannot complete, e.g. percentages
+          if ((hasHt && !htOk) || (hasWd && !wdOk) || (hasHt && hasWd))
+            continue;
+          const QSize imgSize = mTextDocument->imageSize(src);
+          if (imgSize.isEmpty())
+            continue;
+          if (hasWd) {
+            img.setAttribute(QStringLiteral("height"), qMax(1, wd * imgSize.height() / imgSize.width()));
+          } else if (hasHt) {
+            img.setAttribute(QStringLiteral("width"), qMax(1, ht * imgSize.width() / imgSize.height()));
+          } else {
+            img.setAttribute(QStringLiteral("height"), imgSize.height());
+            img.setAttribute(QStringLiteral("width"), imgSize.width());
+          }
+        }
+
         // handle embedded videos
         QDomNodeList videoTags = dom.elementsByTagName(QStringLiteral("video"));
         while(!videoTags.isEmpty()) {
@@ -8,15 +8,22 @@
  ***************************************************************************/
 
 #include "epubdocument.h"
+#include <QBuffer>
 #include <QTemporaryFile>
 #include <QDir>
+#include <QImageReader>
 
 #include <QRegExp>
 
 Q_LOGGING_CATEGORY(OkularEpuDebug, "org.kde.okular.generators.epu", QtWarningMsg)
 using namespace Epub;
 
+// budget for decoded images, in KB; anything evicted is decoded again from
+// the archive the next time it is painted
+static const int ImageCacheSize = 32 * 1024;
+
 EpubDocument::EpubDocument(const QString &fileName) : QTextDocument(),
+    mImageCache(ImageCacheSize),
     padding(20)
 {
   mEpub = epub_open(qPrintable(fileName), 3);
@@ -61,6 +68,50 @@ int EpubDocument::maxContentWidth() const
   return pageSize().width() - (2 * padding);
 }
 
+QSize EpubDocument::fitToContent(const QSize &size) const
+{
+  QSize result = size;
+  const int maxHeight = maxContentHeight();
+  const int maxWidth = maxContentWidth();
+  if(result.height() > maxHeight)
+    result = QSize(qMax(1, result.width() * maxHeight / result.height()), maxHeight);
+  if(result.width() > maxWidth)
+    result = QSize(maxWidth, qMax(1, result.height() * maxWidth / result.width()));
+  return result;
+}
+
+// Returns @p name resolved against the current sub document, as an absolute
+// url, so that it points to the same file whichever the current sub document
+// is when the resource is eventually loaded
+QUrl EpubDocument::resolveUrl(const QUrl &name) const
+{
+  const QUrl url = mCurrentSubDocument.resolved(name);
+  return url.isRelative() ? QUrl::fromLocalFile(url.path()) : url;
+}
+
+QSize EpubDocument::imageSize(const QUrl &name)
+{
+  const QString fileInPath = resolveUrl(name).path();
+  const QImage *cached = mImageCache.object(fileInPath);
+  if (cached)
+    return cached->size();
+
+  char *data;
+  const int size = epub_get_data(mEpub, fileInPath.toUtf8().constData(), &data);
+  if (!data)
+    return QSize();
+
+  // only read the header, the pixels are decoded when the image is painted
+  QByteArray ba = QByteArray::fromRawData(data, size);
+  QBuffer buffer(&ba);
+  buffer.open(QIODevice::ReadOnly);
+  QImageReader reader(&buffer);
+  const QSize imgSize = reader.size();
+  free(data);
+
+  return imgSize.isValid() ? fitToContent(imgSize) : QSize();
+}
+
 void EpubDocument::checkCSS(QString &css)
 {
   // remove paragraph line-heights
@@ -72,7 +123,13 @@ QVariant EpubDocument::loadResource(int type, const QUrl &name)
   int size;
   char *data;
 
-  QString fileInPath = mCurrentSubDocument.resolved(name).path();
+  QString fileInPath = resolveUrl(name).path();
+
+  if (type == QTextDocument::ImageResource) {
+    const QImage *cached = mImageCache.object(fileInPath);
+    if (cached)
+      return *cached;
+  }
 
   // Get the data from the epub file
   size = epub_get_data(mEpub, fileInPath.toUtf8().constData(), &data);
@@ -83,14 +140,15 @@ QVariant EpubDocument::loadResource(int type, const QUrl &name)
     switch(type) {
     case QTextDocument::ImageResource:{
       QImage img = QImage::fromData((unsigned char *)data, size);
-      const int maxHeight = maxContentHeight();
-      const int maxWidth = maxContentWidth();
-      if(img.height() > maxHeight)
-        img = img.scaledToHeight(maxHeight, Qt::SmoothTransformation);
-      if(img.width() > maxWidth)
-        img = img.scaledToWidth(maxWidth, Qt::SmoothTransformation);
+      const QSize fitted = fitToContent(img.size());
+      if(!img.isNull() && fitted != img.size())
+        img = img.scaled(fitted, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
       resource.setValue(img);
-      break;
+      // images are not added to the document resources, which would keep
+      // every picture of the book decoded for the whole session
+      mImageCache.insert(fileInPath, new QImage(img), qMax(1, img.byteCount() / 1024));
+      free(data);
+      return resource;
     }
     case QTextDocument::StyleSheetResource: {
       QString css = QString::fromUtf8(data);
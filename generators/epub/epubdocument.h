@@ -10,6 +10,7 @@
 #ifndef EPUB_DOCUMENT_H
 #define EPUB_DOCUMENT_H
 
+#include <QCache>
 #include <QTextDocument>
 #include <QUrl>
 #include <QVariant>
@@ -31,6 +32,8 @@ namespace Epub {
     void setCurrentSubDocument(const QString &doc);
     int maxContentHeight() const;
     int maxContentWidth() const;
+    QUrl resolveUrl(const QUrl &name) const;
+    QSize imageSize(const QUrl &name);
     enum Multimedia { MovieResource = 4, AudioResource = 5 };
 
   protected:
@@ -38,9 +41,11 @@ namespace Epub {
 
   private:
     void checkCSS(QString &css);
+    QSize fitToContent(const QSize &size) const;
 
     struct epub *mEpub;
     QUrl mCurrentSubDocument;
+    QCache<QString, QImage> mImageCache;
 
     int padding;
 
@@ -12,6 +12,7 @@
 #include <stdlib.h>
 
 #include <QFile>
+#include <QtEndian>
 
 #include "faxexpand.h"
 
@@ -58,14 +59,19 @@ static void normalize( pagenode *pn, int revbits, int swapbytes, size_t length )
 
 static bool new_image( pagenode *pn, int width, int height )
 {
-    pn->image = QImage( width, height, QImage::Format_MonoLSB );
+    // the expander writes straight into the 1 bit image, see FaxDocument::load()
+    pn->image = QImage( width, height, QImage::Format_Mono );
+    if ( pn->image.isNull() )
+        return false;
+
     pn->image.setColor( 0, qRgb( 255, 255, 255 ) );
     pn->image.setColor( 1, qRgb( 0, 0, 0 ) );
+    pn->image.fill( 0 );
     pn->bytes_per_line = pn->image.bytesPerLine();
     pn->dpi = FAX_DPI_FINE;
-    pn->imageData = new uchar[ width * height ];
+    pn->imageData = pn->image.bits();
 
-    return !pn->image.isNull();
+    return true;
 }
 
 /* get compressed data into memory */
@@ -257,7 +263,6 @@ FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
 FaxDocument::~FaxDocument()
 {
     delete [] d->mPageNode.dataOrig;
-    delete [] d->mPageNode.imageData;
     delete d;
 }
 
@@ -269,37 +274,12 @@ bool FaxDocument::load()
     if ( !ok )
         return false;
 
-    // byte-swapping the image
-    int height = d->mPageNode.size.height();
-    int bytes_per_line = d->mPageNode.size.width()/8;
-
-    QByteArray bytes( height * bytes_per_line, 0 );
-    for ( int y= height - 1; y >= 0; --y )
-    {
-        quint32 offset  = y * bytes_per_line;
-        quint32 *source = (quint32 *) (d->mPageNode.imageData + offset);
-        quint32 *dest   = (quint32 *) (bytes.data() + offset);
-        for ( int x= (bytes_per_line/4) - 1; x >= 0; --x )
-        {
-            quint32 dv = 0, sv = *source;
-            for ( int bit = 32; bit > 0; --bit )
-            {
-                dv <<= 1;
-                dv |= sv&1;
-                sv >>= 1;
-            }
-            *dest = dv;
-            ++dest;
-            ++source;
-        }
-    }
-
-    // convert it into a QImage
-    QImage img( (uchar*)bytes.data(), d->mPageNode.size.width(), d->mPageNode.size.height(), QImage::Format_MonoLSB );
-    img.setColor( 0, qRgb( 255, 255, 255 ) );
-    img.setColor( 1, qRgb( 0, 0, 0 ) );
-
-    d->mPageNode.image = img.copy().scaled( img.width(), img.height() * 1.5 );
+    // draw_line() packs the pixels of each 32 bit word starting from the most
+    // significant bit, so storing the words big endian gives Format_Mono
+    quint32 *words = (quint32 *) d->mPageNode.image.bits();
+    const int count = d->mPageNode.image.byteCount() / 4;
+    for ( int i = 0; i < count; ++i )
+        words[ i ] = qToBigEndian( words[ i ] );
 
     return true;
 }
@@ -308,3 +288,8 @@ QImage FaxDocument::image() const
 {
     return d->mPageNode.image;
 }
+
+QSize FaxDocument::pageSize() const
+{
+    return QSize( d->mPageNode.size.width(), d->mPageNode.size.height() * 3 / 2 );
+}
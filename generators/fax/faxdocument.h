@@ -49,10 +49,15 @@ class FaxDocument
     bool load();
 
     /**
-     * Returns the document as an image.
+     * Returns the document as a 1 bit image at the resolution it was encoded with.
      */
     QImage image() const;
 
+    /**
+     * Returns the size the page should be displayed at.
+     */
+    QSize pageSize() const;
+
   private:
     class Private;
     Private* const d;
@@ -73,7 +73,7 @@ class pagenode {		/* compressed page descriptor */
     unsigned int bytes_per_line;
     QString filename;         /* The name of the file to be opened */
     QImage image;             /* The final image */
-    uchar *imageData;         /* The temporary raw image data */
+    uchar *imageData;         /* The bits of image, written by the expander */
 };
 
 /* page orientation flags */
@@ -9,8 +9,11 @@
 
 #include "generator_fax.h"
 
+#include <string.h>
+
 #include <QPainter>
 #include <QPrinter>
+#include <QVector>
 
 #include <KAboutData>
 #include <KLocalizedString>
@@ -20,6 +23,78 @@
 
 OKULAR_EXPORT_PLUGIN(FaxGenerator, "libokularGenerator_fax.json")
 
+// Scales the 1 bit page to greyscale, each destination pixel getting the
+// share of white in the source area it covers. Unlike QImage::scaled() this
+// never converts the whole page to 32 bits.
+static QImage scaleBilevel( const QImage &source, int width, int height )
+{
+    const int sourceWidth = source.width();
+    const int sourceHeight = source.height();
+    if ( width <= 0 || height <= 0 )
+        return QImage();
+    if ( source.format() != QImage::Format_Mono )
+        return source.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+
+    QImage result( width, height, QImage::Format_Grayscale8 );
+    if ( result.isNull() )
+        return result;
+
+    // the source pixels are summed into bins, at most one per destination
+    // column; when enlarging, neighbouring columns share a bin
+    const int bins = qMin( width, sourceWidth );
+    QVector<int> bin( sourceWidth );
+    QVector<int> binWidth( bins, 0 );
+    for ( int x = 0; x < sourceWidth; ++x )
+    {
+        bin[ x ] = qint64( x ) * bins / sourceWidth;
+        ++binWidth[ bin[ x ] ];
+    }
+
+    QVector<uchar> grey( bins );
+    QVector<int> black( bins );
+    for ( int row = 0; row < height; ++row )
+    {
+        const int rowStart = qint64( row ) * sourceHeight / height;
+        const int rowEnd = qMax( rowStart + 1, int( qint64( row + 1 ) * sourceHeight / height ) );
+
+        black.fill( 0 );
+        for ( int y = rowStart; y < rowEnd; ++y )
+        {
+            const uchar *line = source.constScanLine( y );
+            for ( int x = 0; x < sourceWidth; x += 8 )
+            {
+                const uchar bits = line[ x / 8 ];
+                // faxes are mostly white, skip whole bytes of it
+                if ( !bits )
+                    continue;
+                const int end = qMin( 8, sourceWidth - x );
+                for ( int i = 0; i < end; ++i )
+                {
+                    if ( bits & ( 0x80 >> i ) )
+                        ++black[ bin[ x + i ] ];
+                }
+            }
+        }
+
+        const int rows = rowEnd - rowStart;
+        for ( int i = 0; i < bins; ++i )
+            grey[ i ] = 255 - 255 * black[ i ] / ( rows * binWidth[ i ] );
+
+        uchar *out = result.scanLine( row );
+        if ( bins == width )
+        {
+            memcpy( out, grey.constData(), width );
+        }
+        else
+        {
+            for ( int x = 0; x < width; ++x )
+                out[ x ] = grey[ qint64( x ) * bins / width ];
+        }
+    }
+
+    return result;
+}
+
 FaxGenerator::FaxGenerator( QObject *parent, const QVariantList &args )
     : Generator( parent, args )
 {
@@ -48,10 +123,11 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
     }
 
     m_img = faxDocument.image();
+    m_pageSize = faxDocument.pageSize();
 
     pagesVector.resize( 1 );
 
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
+    Okular::Page * page = new Okular::Page( 0, m_pageSize.width(), m_pageSize.height(), Okular::Rotation0 );
     pagesVector[0] = page;
 
     return true;
@@ -60,6 +136,7 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
 bool FaxGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_pageSize = QSize();
 
     return true;
 }
@@ -72,7 +149,7 @@ QImage FaxGenerator::image( Okular::PixmapRequest * request )
     if ( request->page()->rotation() % 2 == 1 )
         qSwap( width, height );
 
-    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    return scaleBilevel( m_img, width, height );
 }
 
 Okular::DocumentInfo FaxGenerator::generateDocumentInfo( const QSet<Okular::DocumentInfo::Key> &keys ) const
@@ -92,14 +169,12 @@ bool FaxGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
-    QImage image( m_img );
-
-    if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
+    QSize size( m_pageSize );
 
-        image = image.scaled( printer.width(), printer.height(),
-                              Qt::KeepAspectRatio, Qt::SmoothTransformation );
+    if ( ( size.width() > printer.width() ) || ( size.height() > printer.height() ) )
+        size.scale( printer.width(), printer.height(), Qt::KeepAspectRatio );
 
-    p.drawImage( 0, 0, image );
+    p.drawImage( 0, 0, scaleBilevel( m_img, size.width(), size.height() ) );
 
     return true;
 }
@@ -37,6 +37,7 @@ class FaxGenerator : public Okular::Generator
 
     private:
         QImage m_img;
+        QSize m_pageSize;
         FaxDocument::DocumentType m_type;
 };
 
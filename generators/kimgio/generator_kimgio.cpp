@@ -32,10 +32,58 @@
 
 #include <core/page.h>
 
+#include "settings_core.h"
+
+// levels of the pyramid are not built below this size
+static const int MinLevelSize = 64;
+
+static void applyExifOrientation( const QByteArray & fileData, QImage & img )
+{
+    KExiv2Iface::KExiv2 exifMetadata;
+    if ( exifMetadata.loadFromData( fileData ) ) {
+        exifMetadata.rotateExifQImage( img, exifMetadata.getImageOrientation() );
+    }
+}
+
+static bool releaseFullImageWanted()
+{
+    return Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Low;
+}
+
+// Halves the size of a RGB32 or ARGB32_Premultiplied image averaging 2x2 pixel boxes
+static QImage halveImage( const QImage & image )
+{
+    const int width = image.width() / 2;
+    const int height = image.height() / 2;
+    QImage result( width, height, image.format() );
+    if ( result.isNull() )
+        return result;
+
+    for ( int y = 0; y < height; ++y ) {
+        const quint32 *row0 = reinterpret_cast<const quint32 *>( image.constScanLine( 2 * y ) );
+        const quint32 *row1 = reinterpret_cast<const quint32 *>( image.constScanLine( 2 * y + 1 ) );
+        quint32 *dest = reinterpret_cast<quint32 *>( result.scanLine( y ) );
+        for ( int x = 0; x < width; ++x ) {
+            const quint32 p0 = row0[ 2 * x ];
+            const quint32 p1 = row0[ 2 * x + 1 ];
+            const quint32 p2 = row1[ 2 * x ];
+            const quint32 p3 = row1[ 2 * x + 1 ];
+            // average two channels at a time, each one has 16 bits of room for the sum
+            const quint32 rb = ( ( p0 & 0x00FF00FF ) + ( p1 & 0x00FF00FF ) +
+                                 ( p2 & 0x00FF00FF ) + ( p3 & 0x00FF00FF ) + 0x00020002 ) >> 2;
+            const quint32 ag = ( ( ( p0 >> 8 ) & 0x00FF00FF ) + ( ( p1 >> 8 ) & 0x00FF00FF ) +
+                                 ( ( p2 >> 8 ) & 0x00FF00FF ) + ( ( p3 >> 8 ) & 0x00FF00FF ) + 0x00020002 ) >> 2;
+            dest[ x ] = ( rb & 0x00FF00FF ) | ( ( ag & 0x00FF00FF ) << 8 );
+        }
+    }
+
+    return result;
+}
+
 OKULAR_EXPORT_PLUGIN(KIMGIOGenerator, "libokularGenerator_kimgio.json")
 
 KIMGIOGenerator::KIMGIOGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_levelsBuilt( false )
 {
     setFeature( ReadRawData );
     setFeature( Threaded );
@@ -85,10 +133,12 @@ bool KIMGIOGenerator::loadDocumentInternal(const QByteArray & fileData, const QS
     docInfo.set( Okular::DocumentInfo::MimeType, mime.name() );
 
     // Apply transformations dictated by Exif metadata
-    KExiv2Iface::KExiv2 exifMetadata;
-    if ( exifMetadata.loadFromData( fileData ) ) {
-        exifMetadata.rotateExifQImage(m_img, exifMetadata.getImageOrientation());
-    }
+    applyExifOrientation( fileData, m_img );
+
+    m_imageSize = m_img.size();
+    // keep the encoded image around to decode it again if we need to release it
+    if ( releaseFullImageWanted() )
+        m_data = fileData;
 
     pagesVector.resize( 1 );
 
@@ -107,27 +157,90 @@ KIMGIOGenerator::SwapBackingFileResult KIMGIOGenerator::swapBackingFile( QString
 
 bool KIMGIOGenerator::doCloseDocument()
 {
+    QMutexLocker locker( &m_mutex );
     m_img = QImage();
+    m_imageSize = QSize();
+    m_data.clear();
+    m_levels.clear();
+    m_levelsBuilt = false;
 
     return true;
 }
 
+const QImage &KIMGIOGenerator::fullImage()
+{
+    if ( m_img.isNull() && !m_data.isEmpty() ) {
+        QBuffer buffer;
+        buffer.setData( m_data );
+        buffer.open( QIODevice::ReadOnly );
+
+        QImageReader reader( &buffer, QImageReader::imageFormat( &buffer ) );
+        reader.setAutoDetectImageFormat( true );
+        reader.read( &m_img );
+        applyExifOrientation( m_data, m_img );
+    }
+
+    return m_img;
+}
+
+void KIMGIOGenerator::releaseFullImage()
+{
+    // only release it when we can decode it again
+    if ( m_levelsBuilt && !m_data.isEmpty() && releaseFullImageWanted() )
+        m_img = QImage();
+}
+
+void KIMGIOGenerator::buildLevels()
+{
+    m_levelsBuilt = true;
+
+    const QImage &image = fullImage();
+    QImage level = image.convertToFormat( image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32 );
+    while ( level.width() >= 2 * MinLevelSize && level.height() >= 2 * MinLevelSize ) {
+        level = halveImage( level );
+        if ( level.isNull() )
+            break;
+        m_levels.append( level );
+    }
+}
+
+QImage KIMGIOGenerator::sourceImage( int width, int height )
+{
+    // the pyramid is built the first time a request can make use of it,
+    // in the generation thread of threaded generators
+    if ( !m_levelsBuilt && width * 2 <= m_imageSize.width() && height * 2 <= m_imageSize.height() )
+        buildLevels();
+
+    // the smallest level that is not smaller than the requested size
+    for ( int i = m_levels.count() - 1; i >= 0; --i ) {
+        const QImage &level = m_levels.at( i );
+        if ( level.width() >= width && level.height() >= height ) {
+            releaseFullImage();
+            return level;
+        }
+    }
+
+    return fullImage();
+}
+
 QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
 {
-    // perform a smooth scaled generation
+    QMutexLocker locker( &m_mutex );
+    QImage result;
+
+    // perform a smooth scaled generation, starting from the nearest larger level
     if ( request->isTile() )
     {
-        const QRect srcRect = request->normalizedRect().geometry( m_img.width(), m_img.height() );
+        const QImage source = sourceImage( request->width(), request->height() );
+        const QRect srcRect = request->normalizedRect().geometry( source.width(), source.height() );
         const QRect destRect = request->normalizedRect().geometry( request->width(), request->height() );
 
-        QImage destImg( destRect.size(), QImage::Format_RGB32 );
-        destImg.fill( Qt::white );
+        result = QImage( destRect.size(), QImage::Format_RGB32 );
+        result.fill( Qt::white );
 
-        QPainter p( &destImg );
+        QPainter p( &result );
         p.setRenderHint( QPainter::SmoothPixmapTransform );
-        p.drawImage( destImg.rect(), m_img, srcRect );
-
-        return destImg;
+        p.drawImage( result.rect(), source, srcRect );
     }
     else
     {
@@ -136,15 +249,23 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
         if ( request->page()->rotation() % 2 == 1 )
             qSwap( width, height );
 
-        return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+        const QImage source = sourceImage( width, height );
+        if ( source.width() == width && source.height() == height )
+            result = source;
+        else
+            result = source.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
     }
+
+    return result;
 }
 
 bool KIMGIOGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
-    QImage image( m_img );
+    QMutexLocker locker( &m_mutex );
+    QImage image( fullImage() );
+    releaseFullImage();
 
     if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
 
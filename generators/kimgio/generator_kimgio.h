@@ -17,6 +17,8 @@
 #include <core/document.h>
 
 #include <QImage>
+#include <QMutex>
+#include <QVector>
 
 class KIMGIOGenerator : public Okular::Generator
 {
@@ -45,8 +47,19 @@ class KIMGIOGenerator : public Okular::Generator
     private:
         bool loadDocumentInternal(const QByteArray & fileData, const QString & fileName,
                                   QVector<Okular::Page*> & pagesVector );
+        const QImage &fullImage();
+        void releaseFullImage();
+        void buildLevels();
+        QImage sourceImage( int width, int height );
     private:
         QImage m_img;
+        QSize m_imageSize;
+        // the encoded image, kept only when the full image may be released
+        QByteArray m_data;
+        // downscaled copies of the image, each half the size of the previous one
+        QVector<QImage> m_levels;
+        bool m_levelsBuilt;
+        QMutex m_mutex;
         Okular::DocumentInfo docInfo;
 };
 
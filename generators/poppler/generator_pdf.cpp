@@ -541,6 +541,7 @@ static void PDFGeneratorPopplerDebugFunction(const QString &message, const QVari
 
 PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
     : Generator( parent, args ), pdfdoc( 0 ),
+    textDoc( 0 ), textDocFailed( false ),
     docSynopsisDirty( true ),
     docEmbeddedFilesDirty( true ), nextFontPage( 0 ),
     annotProxy( 0 )
@@ -584,6 +585,7 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentWithPassword( const QStri
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::load( filePath, 0, 0 );
+    docFilePath = filePath;
     return init(pagesVector, password);
 }
 
@@ -598,6 +600,7 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentFromDataWithPassword( con
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData( fileData, 0, 0 );
+    docFileData = fileData;
     return init(pagesVector, password);
 }
 
@@ -637,6 +640,9 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page*> & pagesVe
     // create annotation proxy
     annotProxy = new PopplerAnnotationProxy( pdfdoc, userMutex(), &annotationsOnOpenHash );
 
+    // the text extraction document is only opened once text is asked for
+    docPassword = password;
+
     // the file has been loaded correctly
     return Okular::Document::OpenSuccess;
 }
@@ -679,6 +685,14 @@ bool PDFGenerator::doCloseDocument()
     delete pdfdoc;
     pdfdoc = 0;
     userMutex()->unlock();
+    textDocMutex.lock();
+    delete textDoc;
+    textDoc = 0;
+    textDocFailed = false;
+    textDocMutex.unlock();
+    docFilePath.clear();
+    docFileData.clear();
+    docPassword.clear();
     docSynopsisDirty = true;
     docSyn.clear();
     docEmbeddedFilesDirty = true;
@@ -1238,17 +1252,58 @@ static bool shouldAbortTextExtractionCallback(const QVariant &vPayload)
 }
 #endif
 
+Poppler::Document *PDFGenerator::textDocument()
+{
+    if ( textDoc || textDocFailed )
+        return textDoc;
+
+    if ( !docFileData.isEmpty() )
+        textDoc = Poppler::Document::loadFromData( docFileData, 0, 0 );
+    else if ( !docFilePath.isEmpty() )
+        textDoc = Poppler::Document::load( docFilePath, 0, 0 );
+
+    if ( textDoc && textDoc->isLocked() )
+        textDoc->unlock( docPassword.toLatin1(), docPassword.toLatin1() );
+
+    if ( !textDoc || textDoc->isLocked() || textDoc->numPages() != pdfdoc->numPages() )
+    {
+        qCDebug(OkularPdfDebug) << "Could not open a second instance of the document, extracting text from the main one";
+        delete textDoc;
+        textDoc = 0;
+        textDocFailed = true;
+    }
+
+    return textDoc;
+}
+
 Okular::TextPage* PDFGenerator::textPage( Okular::TextRequest *request )
 {
     const Okular::Page *page = request->page();
 #ifdef PDFGENERATOR_DEBUG
     qCDebug(OkularPdfDebug) << "page" << page->number();
 #endif
+    if ( request->shouldAbortExtraction() )
+        return nullptr;
+
+    // text extraction works on its own document instance whenever possible,
+    // so rendering of other pages can go on in parallel
+    QMutexLocker textDocLocker( &textDocMutex );
+    Poppler::Document *doc = textDocument();
+    QMutex *docMutex = doc ? nullptr : userMutex();
+    if ( !doc )
+    {
+        textDocLocker.unlock();
+        doc = pdfdoc;
+    }
+    QMutexLocker docLocker( docMutex );
+
+    if ( request->shouldAbortExtraction() )
+        return nullptr;
+
     // build a TextList...
     QList<Poppler::TextBox*> textList;
     double pageWidth, pageHeight;
-    userMutex()->lock();
-    Poppler::Page *pp = pdfdoc->page( page->number() );
+    Poppler::Page *pp = doc->page( page->number() );
     if (pp)
     {
 #ifdef HAVE_POPPLER_0_63
@@ -1267,10 +1322,14 @@ Okular::TextPage* PDFGenerator::textPage( Okular::TextRequest *request )
         pageHeight = defaultPageHeight;
     }
     delete pp;
-    userMutex()->unlock();
+    docLocker.unlock();
+    textDocLocker.unlock();
 
-    if ( textList.isEmpty() && request->shouldAbortExtraction() )
+    if ( request->shouldAbortExtraction() )
+    {
+        qDeleteAll(textList);
         return nullptr;
+    }
 
     Okular::TextPage *tp = abstractTextPage(textList, pageHeight, pageWidth, (Poppler::Page::Rotation)page->orientation());
     qDeleteAll(textList);
@@ -20,6 +20,7 @@
 
 
 #include <qbitarray.h>
+#include <qmutex.h>
 #include <qpointer.h>
 
 #include <core/document.h>
@@ -129,9 +130,22 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
 
         bool setDocumentRenderHints();
 
+        // returns the document used for text extraction, loading it on first
+        // use; textDocMutex must be held
+        Poppler::Document *textDocument();
+
         // poppler dependant stuff
         Poppler::Document *pdfdoc;
 
+        // a second instance of the same file, so that text extraction does
+        // not have to wait for userMutex while pages are rendered
+        Poppler::Document *textDoc;
+        QMutex textDocMutex;
+        bool textDocFailed;
+        QString docFilePath;
+        QByteArray docFileData;
+        QString docPassword;
+
 
         // misc variables for document info and synopsis caching
         bool docSynopsisDirty;
@@ -16,12 +16,15 @@
 #include <qimage.h>
 #include <qlist.h>
 #include <qpainter.h>
+#include <QCache>
+#include <QMutex>
 #include <QPrinter>
 
 #include <kaboutdata.h>
 #include <QDebug>
 #include <KLocalizedString>
 
+#include <core/area.h>
 #include <core/document.h>
 #include <core/page.h>
 #include <core/fileprinter.h>
@@ -30,6 +33,8 @@
 #include <tiff.h>
 #include <tiffio.h>
 
+#include <algorithm>
+
 #define TiffDebug 4714
 
 tsize_t okular_tiffReadProc( thandle_t handle, tdata_t buf, tsize_t size )
@@ -85,17 +90,263 @@ void okular_tiffUnmapProc( thandle_t, tdata_t, toff_t )
 }
 
 
+// minimum number of rows of a strip based block, strips are usually much smaller
+static const uint32 MinBlockRows = 64;
+// size of the decoded block cache, in kilobytes
+static const int BlockCacheSize = 64 * 1024;
+// maximum number of source pixels decoded at once when scaling
+static const qint64 MaxBandPixels = 16 * 1024 * 1024;
+
 class TIFFGenerator::Private
 {
     public:
         Private()
-          : tiff( nullptr ), dev( nullptr ) {}
+          : tiff( nullptr ), dev( nullptr )
+        {
+            blockCache.setMaxCost( BlockCacheSize );
+        }
+
+        /**
+         * A resolution level of a page: the page directory itself or one
+         * of its reduced resolution subfiles. Levels are decoded in blocks,
+         * which are the tiles of tiled images or groups of whole strips.
+         */
+        struct Level
+        {
+            quint64 offset;
+            uint32 width;
+            uint32 height;
+            uint32 blockWidth;
+            uint32 blockHeight;
+            uint16 orientation;
+        };
+
+        static Level readLevel( TIFF *tiff );
+        static bool levelWidthGreaterThan( const Level &l1, const Level &l2 );
+
+        QImage render( int page, const Okular::NormalizedRect &rect, int width, int height );
+        QImage readRegion( const Level &level, const QRect &rect );
+        QImage readBlock( const Level &level, int block, const QRect &blockRect );
 
         TIFF* tiff;
         QByteArray data;
         QIODevice* dev;
+        // resolution levels of each page, the full resolution one first
+        QHash< int, QVector< Level > > levels;
+        QCache< QPair< quint64, int >, QImage > blockCache;
+        QMutex mutex;
 };
 
+TIFFGenerator::Private::Level TIFFGenerator::Private::readLevel( TIFF *tiff )
+{
+    Level level;
+    level.offset = TIFFCurrentDirOffset( tiff );
+    level.width = 0;
+    level.height = 0;
+    TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &level.width );
+    TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &level.height );
+
+    if ( !TIFFGetField( tiff, TIFFTAG_ORIENTATION, &level.orientation ) )
+        level.orientation = ORIENTATION_TOPLEFT;
+
+    level.blockWidth = level.width;
+    level.blockHeight = level.height;
+    if ( TIFFIsTiled( tiff ) )
+    {
+        TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &level.blockWidth );
+        TIFFGetField( tiff, TIFFTAG_TILELENGTH, &level.blockHeight );
+    }
+    else
+    {
+        uint32 rowsPerStrip = 0;
+        TIFFGetFieldDefaulted( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
+        rowsPerStrip = qBound( (uint32)1, rowsPerStrip, qMax( level.height, (uint32)1 ) );
+        level.blockHeight = ( ( MinBlockRows + rowsPerStrip - 1 ) / rowsPerStrip ) * rowsPerStrip;
+    }
+    level.blockWidth = qBound( (uint32)1, level.blockWidth, qMax( level.width, (uint32)1 ) );
+    level.blockHeight = qBound( (uint32)1, level.blockHeight, qMax( level.height, (uint32)1 ) );
+
+    return level;
+}
+
+static bool isReducedImage( TIFF *tiff )
+{
+    uint32 subfileType = 0;
+    return TIFFGetField( tiff, TIFFTAG_SUBFILETYPE, &subfileType ) && ( subfileType & FILETYPE_REDUCEDIMAGE );
+}
+
+bool TIFFGenerator::Private::levelWidthGreaterThan( const Level &l1, const Level &l2 )
+{
+    return l1.width > l2.width;
+}
+
+/**
+ * Decodes the given area of the current directory with the given raster
+ * orientation. Only the strips or tiles intersecting the area are read.
+ */
+static QImage readRGBARegion( TIFF *tiff, const QRect &rect, uint16 orientation )
+{
+    char emsg[1024];
+    TIFFRGBAImage rgbaImage;
+    if ( !TIFFRGBAImageOK( tiff, emsg ) || !TIFFRGBAImageBegin( &rgbaImage, tiff, 0, emsg ) )
+    {
+        qCWarning(OkularTiffDebug) << "Cannot decode image:" << emsg;
+        return QImage();
+    }
+
+    rgbaImage.req_orientation = orientation;
+    rgbaImage.row_offset = rect.y();
+    rgbaImage.col_offset = rect.x();
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    // the ABGR words of the raster are RGBA in memory, so leave the red
+    // and blue swap to the (vectorised) Qt format conversion
+    QImage image( rect.size(), QImage::Format_RGBX8888 );
+#else
+    QImage image( rect.size(), QImage::Format_RGB32 );
+#endif
+    if ( image.isNull() )
+    {
+        TIFFRGBAImageEnd( &rgbaImage );
+        return QImage();
+    }
+
+    const int ok = TIFFRGBAImageGet( &rgbaImage, (uint32 *)image.bits(), rect.width(), rect.height() );
+    TIFFRGBAImageEnd( &rgbaImage );
+    if ( !ok )
+        return QImage();
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    return image.convertToFormat( QImage::Format_RGB32 );
+#else
+    // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
+    uint32 * data = (uint32 *)image.bits();
+    const uint32 size = rect.width() * rect.height();
+    for ( uint32 i = 0; i < size; ++i )
+    {
+        uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
+        uint32 blue = ( data[i] & 0x000000FF ) << 16;
+        data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
+    }
+    return image;
+#endif
+}
+
+QImage TIFFGenerator::Private::readBlock( const Level &level, int block, const QRect &blockRect )
+{
+    const QPair< quint64, int > key( level.offset, block );
+    if ( QImage *cached = blockCache.object( key ) )
+        return *cached;
+
+    if ( TIFFCurrentDirOffset( tiff ) != level.offset && !TIFFSetSubDirectory( tiff, level.offset ) )
+        return QImage();
+
+    const QImage image = readRGBARegion( tiff, blockRect, level.orientation );
+    if ( image.isNull() )
+        return image;
+
+    // never let a block cost nothing, the cache would not evict it
+    const int cost = qMax( 1, int( qint64( image.bytesPerLine() ) * image.height() / 1024 ) );
+    if ( cost <= blockCache.maxCost() )
+        blockCache.insert( key, new QImage( image ), cost );
+
+    return image;
+}
+
+QImage TIFFGenerator::Private::readRegion( const Level &level, const QRect &rect )
+{
+    QImage region( rect.size(), QImage::Format_RGB32 );
+    if ( region.isNull() )
+        return region;
+
+    const int columns = ( level.width + level.blockWidth - 1 ) / level.blockWidth;
+    const int firstColumn = rect.left() / level.blockWidth;
+    const int lastColumn = rect.right() / level.blockWidth;
+    const int firstRow = rect.top() / level.blockHeight;
+    const int lastRow = rect.bottom() / level.blockHeight;
+    const QRect levelRect( 0, 0, level.width, level.height );
+
+    QPainter p( &region );
+    p.setCompositionMode( QPainter::CompositionMode_Source );
+    for ( int row = firstRow; row <= lastRow; ++row )
+    {
+        for ( int column = firstColumn; column <= lastColumn; ++column )
+        {
+            const QRect blockRect = QRect( column * level.blockWidth, row * level.blockHeight,
+                                           level.blockWidth, level.blockHeight ) & levelRect;
+            const QImage block = readBlock( level, row * columns + column, blockRect );
+            if ( block.isNull() )
+                return QImage();
+
+            const QRect area = blockRect & rect;
+            p.drawImage( area.topLeft() - rect.topLeft(), block, area.translated( -blockRect.topLeft() ) );
+        }
+    }
+
+    return region;
+}
+
+QImage TIFFGenerator::Private::render( int page, const Okular::NormalizedRect &rect, int width, int height )
+{
+    const QVector< Level > pageLevels = levels.value( page );
+    if ( pageLevels.isEmpty() || width <= 0 || height <= 0 )
+        return QImage();
+
+    // use the smallest level that is not smaller than the requested size
+    Level level = pageLevels.first();
+    for ( int i = pageLevels.count() - 1; i > 0; --i )
+    {
+        if ( pageLevels.at( i ).width >= (uint32)width && pageLevels.at( i ).height >= (uint32)height )
+        {
+            level = pageLevels.at( i );
+            break;
+        }
+    }
+
+    const QRect levelRect( 0, 0, level.width, level.height );
+    const QRect srcRect = rect.geometry( level.width, level.height ) & levelRect;
+    const QSize destSize = rect.geometry( width, height ).size();
+    if ( srcRect.isEmpty() || destSize.isEmpty() )
+        return QImage();
+
+    if ( srcRect.size() == destSize )
+        return readRegion( level, srcRect );
+
+    if ( (qint64)srcRect.width() * srcRect.height() <= MaxBandPixels )
+    {
+        const QImage region = readRegion( level, srcRect );
+        if ( region.isNull() )
+            return region;
+        return region.scaled( destSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    }
+
+    // scale horizontal bands, so that the whole source area is never decoded at once
+    QImage result( destSize, QImage::Format_RGB32 );
+    if ( result.isNull() )
+        return result;
+
+    const double scaleY = (double)srcRect.height() / destSize.height();
+    const int bandRows = qMax( 1, (int)( MaxBandPixels / ( srcRect.width() * qMax( 1.0, scaleY ) ) ) );
+
+    QPainter p( &result );
+    p.setCompositionMode( QPainter::CompositionMode_Source );
+    for ( int y = 0; y < destSize.height(); y += bandRows )
+    {
+        const int rows = qMin( bandRows, destSize.height() - y );
+        const int srcTop = srcRect.top() + qRound( y * scaleY );
+        const int srcBottom = srcRect.top() + qRound( ( y + rows ) * scaleY );
+        const QRect srcBand = QRect( srcRect.left(), srcTop, srcRect.width(), qMax( 1, srcBottom - srcTop ) ) & levelRect;
+
+        const QImage band = readRegion( level, srcBand );
+        if ( band.isNull() )
+            return QImage();
+
+        p.drawImage( 0, y, band.scaled( destSize.width(), rows, Qt::IgnoreAspectRatio, Qt::SmoothTransformation ) );
+    }
+
+    return result;
+}
+
 static QDateTime convertTIFFDateTime( const char* tiffdate )
 {
     if ( !tiffdate )
@@ -164,6 +415,7 @@ TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
       d( new Private )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( ReadRawData );
@@ -228,6 +480,8 @@ bool TIFFGenerator::doCloseDocument()
         d->dev = nullptr;
         d->data.clear();
         m_pageMapping.clear();
+        d->levels.clear();
+        d->blockCache.clear();
     }
 
     return true;
@@ -235,49 +489,27 @@ bool TIFFGenerator::doCloseDocument()
 
 QImage TIFFGenerator::image( Okular::PixmapRequest * request )
 {
-    bool generated = false;
-    QImage img;
+    QMutexLocker locker( &d->mutex );
 
-    if ( TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
+    QImage img;
+    if ( request->isTile() )
     {
-        int rotation = request->page()->rotation();
-        uint32 width = 1;
-        uint32 height = 1;
-        uint32 orientation = 0;
-        TIFFGetField( d->tiff, TIFFTAG_IMAGEWIDTH, &width );
-        TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height );
-
-        if ( !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
-            orientation = ORIENTATION_TOPLEFT;
-
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
-
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
-        {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
-            {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
-
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if ( rotation % 2 == 1 )
-                qSwap( reqwidth, reqheight );
-            img = image.scaled( reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
-
-            generated = true;
-        }
+        img = d->render( request->page()->number(), request->normalizedRect(), request->width(), request->height() );
+    }
+    else
+    {
+        int reqwidth = request->width();
+        int reqheight = request->height();
+        if ( request->page()->rotation() % 2 == 1 )
+            qSwap( reqwidth, reqheight );
+        img = d->render( request->page()->number(), Okular::NormalizedRect( 0, 0, 1, 1 ), reqwidth, reqheight );
     }
 
-    if ( !generated )
+    if ( img.isNull() )
     {
-        img = QImage( request->width(), request->height(), QImage::Format_RGB32 );
+        const QSize size = request->isTile() ? request->normalizedRect().geometry( request->width(), request->height() ).size()
+                                             : QSize( request->width(), request->height() );
+        img = QImage( size, QImage::Format_RGB32 );
         img.fill( qRgb( 255, 255, 255 ) );
     }
 
@@ -357,6 +589,33 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
         adaptSizeToResolution( d->tiff, TIFFTAG_XRESOLUTION, dpi.width(), &width );
         adaptSizeToResolution( d->tiff, TIFFTAG_YRESOLUTION, dpi.height(), &height );
 
+        // reduced resolution versions of a page are not pages on their own
+        if ( realdirs > 0 && isReducedImage( d->tiff ) )
+        {
+            d->levels[ realdirs - 1 ].append( Private::readLevel( d->tiff ) );
+            continue;
+        }
+
+        QVector< Private::Level > &pageLevels = d->levels[ realdirs ];
+        pageLevels.append( Private::readLevel( d->tiff ) );
+
+        // and so are the reduced resolution subfiles of the page
+        uint16 subIfdCount = 0;
+        toff_t *subIfdOffsets = nullptr;
+        if ( TIFFGetField( d->tiff, TIFFTAG_SUBIFD, &subIfdCount, &subIfdOffsets ) && subIfdCount > 0 )
+        {
+            QVector< toff_t > offsets;
+            for ( uint16 j = 0; j < subIfdCount; ++j )
+                offsets.append( subIfdOffsets[ j ] );
+
+            Q_FOREACH ( toff_t offset, offsets )
+            {
+                if ( TIFFSetSubDirectory( d->tiff, offset ) && isReducedImage( d->tiff ) )
+                    pageLevels.append( Private::readLevel( d->tiff ) );
+            }
+            TIFFSetDirectory( d->tiff, i );
+        }
+
         Okular::Page * page = new Okular::Page( realdirs, width, height, readTiffRotation( d->tiff ) );
         pagesVector[ realdirs ] = page;
 
@@ -366,6 +625,9 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
     }
 
     pagesVector.resize( realdirs );
+
+    for ( QHash< int, QVector< Private::Level > >::iterator it = d->levels.begin(), end = d->levels.end(); it != end; ++it )
+        std::sort( it.value().begin() + 1, it.value().end(), Private::levelWidthGreaterThan );
 }
 
 bool TIFFGenerator::print( QPrinter& printer )
@@ -373,6 +635,7 @@ bool TIFFGenerator::print( QPrinter& printer )
     uint32 width = 0;
     uint32 height = 0;
 
+    QMutexLocker locker( &d->mutex );
     QPainter p( &printer );
 
     QList<int> pageList = Okular::FilePrinter::pageList( printer, document()->pages(),
@@ -388,20 +651,11 @@ bool TIFFGenerator::print( QPrinter& printer )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
-
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, ORIENTATION_TOPLEFT ) != 0 )
+        QImage image = readRGBARegion( d->tiff, QRect( 0, 0, width, height ), ORIENTATION_TOPLEFT );
+        if ( image.isNull() )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
-            {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
+            image = QImage( width, height, QImage::Format_RGB32 );
+            image.fill( qRgb( 255, 255, 255 ) );
         }
 
         if ( i != 0 )
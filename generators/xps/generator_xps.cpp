@@ -30,6 +30,7 @@
 #include <QBuffer>
 #include <QImageReader>
 #include <QMutex>
+#include <QMutexLocker>
 
 #include <core/document.h>
 #include <core/page.h>
@@ -38,6 +39,11 @@
 
 OKULAR_EXPORT_PLUGIN(XpsGenerator, "libokularGenerator_xps.json")
 
+// number of recorded pages kept around
+static const int MaxDisplayLists = 32;
+// budget of the decoded images, in KiB
+static const int ImageCacheSize = 64 * 1024;
+
 Q_DECLARE_METATYPE( QGradient* )
 Q_DECLARE_METATYPE( XpsPathFigure* )
 Q_DECLARE_METATYPE( XpsPathGeometry* )
@@ -802,6 +808,9 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     }
     const QString absoluteFileName = absolutePath( entryPath( m_page->fileName() ), node.attributes.value(QStringLiteral("FontUri")) );
     QFont font = m_page->m_file->getFontByName( absoluteFileName, fontSize );
+    // sized to its em size in drawing units, keeping the fraction: rounding
+    // to whole pixels would make the glyphs drift once the page is scaled
+    font.setPointSizeF( fontSize * 72.0 / m_painter->device()->logicalDpiY() );
     att = node.attributes.value( QStringLiteral("StyleSimulations") );
     if  ( !att.isEmpty() ) {
         if ( att == QLatin1String( "ItalicSimulation" ) ) {
@@ -818,6 +827,9 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     //Origin
     QPointF origin( node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble() );
 
+    // invisible text is not drawn, but it is still extracted
+    bool visible = true;
+
     //Fill
     QBrush brush;
     att = node.attributes.value(QStringLiteral("Fill"));
@@ -828,15 +840,13 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            m_painter->restore();
-            return;
+            visible = false;
         }
     } else {
         brush = parseRscRefColorForBrush( att );
         if ( brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern
              && brush.color().alpha() == 0 ) {
-            m_painter->restore();
-            return;
+            visible = false;
         }
     }
     m_painter->setBrush( brush );
@@ -850,8 +860,7 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         if ( ok && value >= 0.1 ) {
             m_painter->setOpacity( value );
         } else {
-            m_painter->restore();
-            return;
+            visible = false;
         }
     }
 
@@ -912,15 +921,19 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     QString stringToDraw( unicodeString( node.attributes.value( QStringLiteral("UnicodeString") ) ) );
     QPointF originAdvance(0, 0);
     QFontMetrics metrics = m_painter->fontMetrics();
+    const QTransform pageTransform = m_painter->worldTransform();
     for ( int i = 0; i < stringToDraw.size(); ++i ) {
         QChar thisChar = stringToDraw.at( i );
-        m_painter->drawText( origin + originAdvance, QString( thisChar ) );
-	const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
-        if ( advanceWidth > 0.0 ) {
-            originAdvance.rx() += advanceWidth;
-        } else {
-            originAdvance.rx() += metrics.width( thisChar );
+        if ( visible ) {
+            m_painter->drawText( origin + originAdvance, QString( thisChar ) );
+        }
+	qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
+        if ( advanceWidth <= 0.0 ) {
+            advanceWidth = metrics.width( thisChar );
         }
+        const QRectF charRect( origin.x() + originAdvance.x(), origin.y() - metrics.height(), advanceWidth, metrics.height() );
+        m_text.append( qMakePair( QString( thisChar ), pageTransform.mapRect( charRect ) ) );
+        originAdvance.rx() += advanceWidth;
     }
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
@@ -1381,10 +1394,8 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
 }
 
 XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
-    m_fileName( fileName ), m_pageIsRendered(false)
+    m_fileName( fileName )
 {
-    m_pageImage = nullptr;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
 
     const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( fileName ));
@@ -1410,38 +1421,38 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
 }
 
 bool XpsPage::renderToImage( QImage *p )
 {
+    p->fill( qRgba( 255, 255, 255, 255 ) );
+    QPainter painter( p );
+    return renderToPainter( &painter );
+}
 
-    if ((m_pageImage == nullptr) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage( p->size(), QImage::Format_ARGB32 );
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX( 2835 );
-        m_pageImage->setDotsPerMeterY( 2835 );
+bool XpsPage::renderToPainter( QPainter *painter )
+{
+    const QSharedPointer<const XpsPageDisplayList> list = m_file->displayList( this );
 
-        m_pageIsRendered = false;
-    }
-    if (! m_pageIsRendered) {
-        m_pageImage->fill( qRgba( 255, 255, 255, 255 ) );
-        QPainter painter( m_pageImage );
-        renderToPainter( &painter );
-        m_pageIsRendered = true;
+    painter->save();
+    painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    {
+        // the generator thread and print() may replay the same page at once
+        QMutexLocker locker( &list->replayMutex );
+        painter->drawPicture( 0, 0, list->picture );
     }
-
-    *p = *m_pageImage;
+    painter->restore();
 
     return true;
 }
 
-bool XpsPage::renderToPainter( QPainter *painter )
+XpsPageDisplayList* XpsPage::recordDisplayList()
 {
+    XpsPageDisplayList *list = new XpsPageDisplayList;
+
     XpsHandler handler( this );
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    QPainter painter( &list->picture );
+    handler.m_painter = &painter;
     QXmlSimpleReader parser;
     parser.setContentHandler( &handler );
     parser.setErrorHandler( &handler );
@@ -1451,8 +1462,11 @@ bool XpsPage::renderToPainter( QPainter *painter )
     QXmlInputSource source( &buffer );
     bool ok = parser.parse( source );
     qCWarning(OkularXpsDebug) << "Parse result: " << ok;
+    painter.end();
 
-    return true;
+    list->text = handler.m_text;
+
+    return list;
 }
 
 QSizeF XpsPage::size() const
@@ -1540,6 +1554,27 @@ KZip * XpsFile::xpsArchive() {
     return m_xpsArchive;
 }
 
+QSharedPointer<const XpsPageDisplayList> XpsFile::displayList( XpsPage *page )
+{
+    QMutexLocker locker( &m_mutex );
+
+    QSharedPointer<const XpsPageDisplayList> list = m_displayLists.value( page->fileName() );
+    if ( list ) {
+        m_displayListsOrder.removeOne( page->fileName() );
+        m_displayListsOrder.append( page->fileName() );
+        return list;
+    }
+
+    list = QSharedPointer<const XpsPageDisplayList>( page->recordDisplayList() );
+    m_displayLists.insert( page->fileName(), list );
+    m_displayListsOrder.append( page->fileName() );
+    while ( m_displayListsOrder.count() > MaxDisplayLists ) {
+        m_displayLists.remove( m_displayListsOrder.takeFirst() );
+    }
+
+    return list;
+}
+
 QImage XpsPage::loadImageFromFile( const QString &fileName )
 {
     // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
@@ -1550,8 +1585,17 @@ QImage XpsPage::loadImageFromFile( const QString &fileName )
         return QImage();
     }
 
-    QString absoluteFileName = absolutePath( entryPath( m_fileName ), fileName );
-    const KZipFileEntry* imageFile = loadFile( m_file->xpsArchive(), absoluteFileName, Qt::CaseInsensitive );
+    return m_file->loadImage( absolutePath( entryPath( m_fileName ), fileName ) );
+}
+
+QImage XpsFile::loadImage( const QString &absoluteFileName )
+{
+    // called while recording a page, so with m_mutex locked
+    if ( QImage *cached = m_imageCache.object( absoluteFileName ) ) {
+        return *cached;
+    }
+
+    const KZipFileEntry* imageFile = loadFile( m_xpsArchive, absoluteFileName, Qt::CaseInsensitive );
     if ( !imageFile ) {
         // image not found
         return QImage();
@@ -1584,6 +1628,11 @@ QImage XpsPage::loadImageFromFile( const QString &fileName )
     reader.setDevice(&buffer);
     reader.read(&image);
 
+    const int cost = image.bytesPerLine() / 1024 * image.height();
+    if ( cost <= m_imageCache.maxCost() ) {
+        m_imageCache.insert( absoluteFileName, new QImage( image ), cost );
+    }
+
     return image;
 }
 
@@ -1593,101 +1642,15 @@ Okular::TextPage* XpsPage::textPage()
 
     Okular::TextPage* textPage = new Okular::TextPage();
 
-    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
-    QXmlStreamReader xml;
-    xml.addData( readFileOrDirectoryParts( pageFile ) );
-
-    QTransform matrix = QTransform();
-    QStack<QTransform> matrices;
-    matrices.push( QTransform() );
-    bool useMatrix = false;
-    QXmlStreamAttributes glyphsAtts;
-
-    while ( ! xml.atEnd() ) {
-        xml.readNext();
-        if ( xml.isStartElement() ) {
-            if ( xml.name() == QStringLiteral("Canvas")) {
-                matrices.push(matrix);
-
-                QString att = xml.attributes().value( QStringLiteral("RenderTransform") ).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix( att ) * matrix;
-                }
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = true;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                if (useMatrix) {
-                    matrix = attsToMatrix( xml.attributes().value(QStringLiteral("Matrix")).toString() ) * matrix;
-                }
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                matrices.push( matrix );
-                glyphsAtts = xml.attributes();
-            } else if ( (xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush"))
-                        || (xml.name() == QStringLiteral("ImageBrush")) ||  (xml.name() == QStringLiteral("ImageBrush.Transform"))
-                        || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data"))
-                        || (xml.name() == QStringLiteral("PathGeometry")) || (xml.name() == QStringLiteral("PathFigure"))
-                        || (xml.name() == QStringLiteral("PolyLineSegment")) ) {
-                // those are only graphical - no use in text handling
-            } else if ( (xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources")) ) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction start: " << xml.name().toString();
-            }
-        } else if (xml.isEndElement() ) {
-            if (xml.name() == QStringLiteral("Canvas")) {
-                matrix = matrices.pop();
-            } else if ((xml.name() == QStringLiteral("Canvas.RenderTransform")) || (xml.name() == QStringLiteral("Glyphs.RenderTransform"))) {
-                useMatrix = false;
-            } else if (xml.name() == QStringLiteral("MatrixTransform")) {
-                // not clear if we need to do anything here yet.
-            } else if (xml.name() == QStringLiteral("Glyphs")) {
-                QString att = glyphsAtts.value( QStringLiteral("RenderTransform") ).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix( att ) * matrix;
-                }
-                QString text = unicodeString( glyphsAtts.value( QStringLiteral("UnicodeString") ).toString() );
-
-                // Get font (doesn't work well because qt doesn't allow to load font from file)
-                const QString absoluteFileName = absolutePath( entryPath( m_fileName ), glyphsAtts.value( QStringLiteral("FontUri") ).toString() );
-                QFont font = m_file->getFontByName( absoluteFileName,
-                                                    glyphsAtts.value(QStringLiteral("FontRenderingEmSize")).toString().toFloat() * 72 / 96 );
-                QFontMetrics metrics = QFontMetrics( font );
-                // Origin
-                QPointF origin( glyphsAtts.value(QStringLiteral("OriginX")).toString().toDouble(),
-                                glyphsAtts.value(QStringLiteral("OriginY")).toString().toDouble() );
-
-
-                int lastWidth = 0;
-                for (int i = 0; i < text.length(); i++) {
-                    int width = metrics.width( text, i + 1 );
-
-                    Okular::NormalizedRect * rect = new Okular::NormalizedRect( (origin.x() + lastWidth) / m_pageSize.width(),
-                                                                                (origin.y() - metrics.height()) / m_pageSize.height(),
-                                                                                (origin.x() + width) / m_pageSize.width(),
-                                                                                origin.y() / m_pageSize.height() );
-                    rect->transform( matrix );
-                    textPage->append( text.mid(i, 1), rect );
-
-                    lastWidth = width;
-                }
-
-                matrix = matrices.pop();
-            } else if ( (xml.name() == QStringLiteral("Path")) || (xml.name() == QStringLiteral("Path.Fill")) || (xml.name() == QStringLiteral("SolidColorBrush"))
-                        || (xml.name() == QStringLiteral("ImageBrush")) ||  (xml.name() == QStringLiteral("ImageBrush.Transform"))
-                        || (xml.name() == QStringLiteral("Path.OpacityMask")) || (xml.name() == QStringLiteral("Path.Data"))
-                        || (xml.name() == QStringLiteral("PathGeometry")) || (xml.name() == QStringLiteral("PathFigure"))
-                        || (xml.name() == QStringLiteral("PolyLineSegment")) ) {
-                // those are only graphical - no use in text handling
-            } else if ( (xml.name() == QStringLiteral("FixedPage")) || (xml.name() == QStringLiteral("FixedPage.Resources")) ) {
-                // not useful for text extraction
-            } else {
-                qCWarning(OkularXpsDebug) << "Unhandled element in Text Extraction end: " << xml.name().toString();
-            }
-        }
-    }
-    if ( xml.error() ) {
-        qCWarning(OkularXpsDebug) << "Error parsing XpsPage text: " << xml.errorString();
+    const QSharedPointer<const XpsPageDisplayList> list = m_file->displayList( this );
+    for ( const QPair<QString, QRectF> &entry : list->text ) {
+        const QRectF &rect = entry.second;
+        textPage->append( entry.first, new Okular::NormalizedRect( rect.left() / m_pageSize.width(),
+                                                                   rect.top() / m_pageSize.height(),
+                                                                   rect.right() / m_pageSize.width(),
+                                                                   rect.bottom() / m_pageSize.height() ) );
     }
+
     return textPage;
 }
 
@@ -1874,6 +1837,7 @@ XpsPage* XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_imageCache( ImageCacheSize )
 {
 }
 
@@ -2034,6 +1998,10 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    m_displayLists.clear();
+    m_displayListsOrder.clear();
+    m_imageCache.clear();
+
     qDeleteAll( m_documents );
     m_documents.clear();
 
@@ -2115,7 +2083,8 @@ bool XpsGenerator::doCloseDocument()
 
 QImage XpsGenerator::image( Okular::PixmapRequest * request )
 {
-    QMutexLocker lock( userMutex() );
+    // the page is recorded under the lock of the file, and replayed under
+    // the lock of its display list, which print() takes as well
     QSize size( (int)request->width(), (int)request->height() );
     QImage image( size, QImage::Format_RGB32 );
     XpsPage *pageToRender = m_xpsFile->page( request->page()->number() );
@@ -2125,7 +2094,6 @@ QImage XpsGenerator::image( Okular::PixmapRequest * request )
 
 Okular::TextPage* XpsGenerator::textPage( Okular::TextRequest * request )
 {
-    QMutexLocker lock( userMutex() );
     XpsPage * xpsPage = m_xpsFile->page( request->page()->number() );
     return xpsPage->textPage();
 }
@@ -23,10 +23,14 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
 #include <QImage>
+#include <QMutex>
+#include <QPicture>
+#include <QSharedPointer>
 #include <QXmlStreamReader>
 #include <QXmlDefaultHandler>
 #include <QStack>
@@ -104,6 +108,18 @@ struct XpsPathGeometry
     XpsMatrixTransform transform;
 };
 
+/**
+    The drawing commands of a page, recorded once in page units, together
+    with the characters drawn and their rectangles
+*/
+struct XpsPageDisplayList
+{
+    QPicture picture;
+    QVector< QPair< QString, QRectF > > text;
+    // replaying the picture seeks in its buffer, so only one replay at a time
+    mutable QMutex replayMutex;
+};
+
 class XpsPage;
 class XpsFile;
 
@@ -144,6 +160,8 @@ protected:
 
     QStack<XpsRenderNode> m_nodes;
 
+    QVector< QPair< QString, QRectF > > m_text;
+
     friend class XpsPage;
 };
 
@@ -162,6 +180,8 @@ public:
     QString fileName() const { return m_fileName; }
 
 private:
+    XpsPageDisplayList* recordDisplayList();
+
     XpsFile *m_file;
     const QString m_fileName;
 
@@ -173,9 +193,7 @@ private:
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
-
+    friend class XpsFile;
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
 };
@@ -274,6 +292,18 @@ public:
 
     QFont getFontByName( const QString &fontName, float size );
 
+    /**
+       the display list of \p page, recorded the first time it is needed
+
+       \note this can be called from any thread
+    */
+    QSharedPointer<const XpsPageDisplayList> displayList( XpsPage *page );
+
+    /**
+       the decoded image stored in the \p absoluteFileName part
+    */
+    QImage loadImage( const QString &absoluteFileName );
+
     KZip* xpsArchive();
 
 
@@ -296,6 +326,12 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    // guards the archive, the fonts and the caches while recording pages
+    QMutex m_mutex;
+    QHash< QString, QSharedPointer<const XpsPageDisplayList> > m_displayLists;
+    QList< QString > m_displayListsOrder;
+    QCache< QString, QImage > m_imageCache;
 };
 
 
@@ -89,10 +89,12 @@
 #include "extensions.h"
 #include "ui/debug_ui.h"
 #include "ui/drawingtoolactions.h"
+#include "ui/pagepainter.h"
 #include "ui/pageview.h"
 #include "ui/toc.h"
 #include "ui/searchwidget.h"
 #include "ui/thumbnaillist.h"
+#include "ui/side_codebook.h"
 #include "ui/side_reviews.h"
 #include "ui/minibar.h"
 #include "ui/embeddedfilesdialog.h"
@@ -403,6 +405,13 @@ m_cliPresentation(false), m_cliPrint(false), m_cliPrintAndExit(false), m_embedMo
                 setWindowTitleFromDocument();
             }
     );
+    // the pixmaps with the accessibility colors applied go with the originals
+    connect( m_document, &Document::pixmapsDeleted, this,
+            [](Okular::DocumentObserver *, int page)
+            {
+                PagePainter::dropAccessiblePixmaps( page );
+            }
+    );
 
     if ( parent && parent->metaObject()->indexOfSlot( QMetaObject::normalizedSignature( "slotQuit()" ).constData() ) != -1 )
         connect( m_document, SIGNAL(quit()), parent, SLOT(slotQuit()) );
@@ -447,6 +456,11 @@ m_cliPresentation(false), m_cliPrint(false), m_cliPrintAndExit(false), m_embedMo
     m_sidebar->addItem( m_reviewsWidget, QIcon::fromTheme(QStringLiteral("draw-freehand")), i18n("Reviews") );
     m_sidebar->setItemEnabled( m_reviewsWidget, false );
 
+    // [left toolbox: Codebook] | []
+    m_codebookWidget = new Codebook( nullptr, m_document );
+    m_sidebar->addItem( m_codebookWidget, QIcon::fromTheme(QStringLiteral("tag")), i18n("Codebook") );
+    m_sidebar->setItemEnabled( m_codebookWidget, false );
+
     // [left toolbox: Bookmarks] | []
     m_bookmarkList = new BookmarkList( m_document, nullptr );
     m_sidebar->addItem( m_bookmarkList, QIcon::fromTheme(QStringLiteral("bookmarks")), i18n("Bookmarks") );
@@ -939,6 +953,7 @@ Part::~Part()
 #endif
     delete m_pageSizeLabel;
     delete m_reviewsWidget;
+    delete m_codebookWidget;
     delete m_bookmarkList;
     delete m_infoTimer;
 
@@ -3408,6 +3423,7 @@ void Part::unsetDummyMode()
        return;
 
     m_sidebar->setItemEnabled( m_reviewsWidget, true );
+    m_sidebar->setItemEnabled( m_codebookWidget, true );
     m_sidebar->setItemEnabled( m_bookmarkList, true );
     m_sidebar->setSidebarVisibility( Okular::Settings::showLeftPanel() );
 
@@ -71,6 +71,7 @@ class MiniBar;
 class MiniBarLogic;
 class FileKeeper;
 class Reviews;
+class Codebook;
 class BookmarkList;
 class DrawingToolActions;
 class Layers;
@@ -321,6 +322,7 @@ class OKULARPART_EXPORT Part : public KParts::ReadWritePart, public Okular::Docu
         QPointer<ProgressWidget> m_progressWidget;
         QPointer<PageSizeLabel> m_pageSizeLabel;
         QPointer<Reviews> m_reviewsWidget;
+        QPointer<Codebook> m_codebookWidget;
         QPointer<BookmarkList> m_bookmarkList;
         QPointer<Layers> m_layers;
 
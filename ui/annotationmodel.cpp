@@ -12,9 +12,11 @@
 
 #include "annotationmodel.h"
 
+#include <qhash.h>
 #include <qlinkedlist.h>
 #include <qlist.h>
 #include <qpointer.h>
+#include <qset.h>
 
 #include <QIcon>
 #include <KLocalizedString>
@@ -37,8 +39,16 @@ struct AnnItem
 
     Okular::Annotation *annotation;
     int page;
+    int row;
 };
 
+// keeps the cached row of the children of item in sync from the given row on
+static void renumberChildren( AnnItem *item, int from )
+{
+    for ( int i = from; i < item->children.count(); ++i )
+        item->children.at( i )->row = i;
+}
+
 static QLinkedList< Okular::Annotation* > filterOutWidgetAnnotations( const QLinkedList< Okular::Annotation* > &annotations )
 {
     QLinkedList< Okular::Annotation* > result;
@@ -65,28 +75,30 @@ public:
 
     QModelIndex indexForItem( AnnItem *item ) const;
     void rebuildTree( const QVector< Okular::Page * > &pages );
-    AnnItem* findItem( int page, int *index ) const;
+    void removeItems( AnnItem *parent, int first, int last );
 
     AnnotationModel *q;
     AnnItem *root;
+    // the page branches, by page number
+    QHash< int, AnnItem* > pageItems;
     QPointer< Okular::Document > document;
 };
 
 
 AnnItem::AnnItem()
-    : parent( nullptr ), annotation( nullptr ), page( -1 )
+    : parent( nullptr ), annotation( nullptr ), page( -1 ), row( 0 )
 {
 }
 
 AnnItem::AnnItem( AnnItem *_parent, Okular::Annotation *ann )
-    : parent( _parent ), annotation( ann ), page( _parent->page )
+    : parent( _parent ), annotation( ann ), page( _parent->page ), row( _parent->children.count() )
 {
     Q_ASSERT( !parent->annotation );
     parent->children.append( this );
 }
 
 AnnItem::AnnItem( AnnItem *_parent, int _page )
-    : parent( _parent ), annotation( nullptr ), page( _page )
+    : parent( _parent ), annotation( nullptr ), page( _page ), row( _parent->children.count() )
 {
     Q_ASSERT( !parent->parent );
     parent->children.append( this );
@@ -138,6 +150,7 @@ void AnnotationModelPrivate::notifySetup( const QVector< Okular::Page * > &pages
     q->beginResetModel();
     qDeleteAll( root->children );
     root->children.clear();
+    pageItems.clear();
 
     rebuildTree( pages );
     q->endResetModel();
@@ -150,110 +163,112 @@ void AnnotationModelPrivate::notifyPageChanged( int page, int flags )
         return;
 
     const QLinkedList< Okular::Annotation* > annots = filterOutWidgetAnnotations( document->page( page )->annotations() );
-    int annItemIndex = -1;
-    AnnItem *annItem = findItem( page, &annItemIndex );
+    AnnItem *annItem = pageItems.value( page );
     // case 1: the page has no more annotations
     //         => remove the branch, if any
     if ( annots.isEmpty() )
     {
         if ( annItem )
         {
-            q->beginRemoveRows( indexForItem( root ), annItemIndex, annItemIndex );
-            delete root->children.at( annItemIndex );
-            root->children.removeAt( annItemIndex );
-            q->endRemoveRows();
+            pageItems.remove( page );
+            removeItems( root, annItem->row, annItem->row );
         }
         return;
     }
     // case 2: no existing branch
-    //         => add a new branch, and add the annotations for the page
+    //         => add a new branch with all the annotations for the page
     if ( !annItem )
     {
-        int i = 0;
-        while ( i < root->children.count() && root->children.at( i )->page < page ) ++i;
+        // the branches are sorted by page
+        int low = 0, high = root->children.count();
+        while ( low < high )
+        {
+            const int mid = ( low + high ) / 2;
+            if ( root->children.at( mid )->page < page )
+                low = mid + 1;
+            else
+                high = mid;
+        }
 
-        AnnItem *annItem = new AnnItem();
+        annItem = new AnnItem();
         annItem->page = page;
         annItem->parent = root;
-        q->beginInsertRows( indexForItem( root ), i, i );
-        annItem->parent->children.insert( i, annItem );
+        for ( Okular::Annotation *annotation : annots )
+            new AnnItem( annItem, annotation );
+
+        q->beginInsertRows( indexForItem( root ), low, low );
+        root->children.insert( low, annItem );
+        renumberChildren( root, low );
+        pageItems.insert( page, annItem );
         q->endInsertRows();
-        QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        int newid = 0;
-        for ( ; it != itEnd; ++it, ++newid )
-        {
-            q->beginInsertRows( indexForItem( annItem ), newid, newid );
-            new AnnItem( annItem, *it );
-            q->endInsertRows();
-        }
         return;
     }
-    // case 3: existing branch, less annotations than items
-    //         => lookup and remove the annotations
-    if ( annItem->children.count() > annots.count() )
+    // case 3: existing branch
+    //         => remove the items whose annotation is gone, in runs of
+    //            adjacent rows, then append the new annotations at once
+    QSet< Okular::Annotation* > pageAnnotations;
+    pageAnnotations.reserve( annots.count() );
+    for ( Okular::Annotation *annotation : annots )
+        pageAnnotations.insert( annotation );
+
+    bool changed = false;
+    for ( int last = annItem->children.count() - 1; last >= 0; --last )
     {
-        for ( int i = annItem->children.count(); i > 0; --i )
-        {
-            Okular::Annotation *ref = annItem->children.at( i - 1 )->annotation;
-            bool found = false;
-            QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-            for ( ; !found && it != itEnd; ++it )
-            {
-                if ( ( *it ) == ref )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginRemoveRows( indexForItem( annItem ), i - 1, i - 1 );
-                delete annItem->children.at( i - 1 );
-                annItem->children.removeAt( i - 1 );
-                q->endRemoveRows();
-            }
-        }
-        return;
+        if ( pageAnnotations.contains( annItem->children.at( last )->annotation ) )
+            continue;
+
+        int first = last;
+        while ( first > 0 && !pageAnnotations.contains( annItem->children.at( first - 1 )->annotation ) )
+            --first;
+        removeItems( annItem, first, last );
+        last = first;
+        changed = true;
     }
-    // case 4: existing branch, less items than annotations
-    //         => lookup and add annotations if not in the branch
-    if ( annots.count() > annItem->children.count() )
+
+    QSet< Okular::Annotation* > itemAnnotations;
+    itemAnnotations.reserve( annItem->children.count() );
+    for ( const AnnItem *item : qAsConst( annItem->children ) )
+        itemAnnotations.insert( item->annotation );
+
+    QList< Okular::Annotation* > added;
+    for ( Okular::Annotation *annotation : annots )
     {
-        QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
-        for ( ; it != itEnd; ++it )
-        {
-            Okular::Annotation *ref = *it;
-            bool found = false;
-            int count = annItem->children.count();
-            for ( int i = 0; !found && i < count; ++i )
-            {
-                if ( ref == annItem->children.at( i )->annotation )
-                    found = true;
-            }
-            if ( !found )
-            {
-                q->beginInsertRows( indexForItem( annItem ), count, count );
-                new AnnItem( annItem, ref );
-                q->endInsertRows();
-            }
-        }
-        return;
+        if ( !itemAnnotations.contains( annotation ) )
+            added.append( annotation );
     }
-    // case 5: the data of some annotation changed
-    // TODO: what do we do in this case?
-    // FIXME: for now, update ALL the annotations for that page
-    for ( int i = 0; i < annItem->children.count(); ++i )
+    if ( !added.isEmpty() )
     {
-        QModelIndex index = indexForItem( annItem->children.at( i ) );
-        emit q->dataChanged( index, index );
+        const int count = annItem->children.count();
+        q->beginInsertRows( indexForItem( annItem ), count, count + added.count() - 1 );
+        for ( Okular::Annotation *annotation : qAsConst( added ) )
+            new AnnItem( annItem, annotation );
+        q->endInsertRows();
+        changed = true;
     }
+    if ( changed )
+        return;
+
+    // case 4: the data of some annotation changed
+    // TODO: what do we do in this case?
+    // FIXME: for now, update ALL the annotations for that page
+    if ( !annItem->children.isEmpty() )
+        emit q->dataChanged( indexForItem( annItem->children.first() ), indexForItem( annItem->children.last() ) );
+}
+
+void AnnotationModelPrivate::removeItems( AnnItem *parent, int first, int last )
+{
+    q->beginRemoveRows( indexForItem( parent ), first, last );
+    for ( int i = first; i <= last; ++i )
+        delete parent->children.at( i );
+    parent->children.erase( parent->children.begin() + first, parent->children.begin() + last + 1 );
+    renumberChildren( parent, first );
+    q->endRemoveRows();
 }
 
 QModelIndex AnnotationModelPrivate::indexForItem( AnnItem *item ) const
 {
     if ( item->parent )
-    {
-        int id = item->parent->children.indexOf( item );
-        if ( id >= 0 && id < item->parent->children.count() )
-           return q->createIndex( id, 0, item );
-    }
+        return q->createIndex( item->row, 0, item );
     return QModelIndex();
 }
 
@@ -270,6 +285,7 @@ void AnnotationModelPrivate::rebuildTree( const QVector< Okular::Page * > &pages
             continue;
 
         AnnItem *annItem = new AnnItem( root, i );
+        pageItems.insert( i, annItem );
         QLinkedList< Okular::Annotation* >::ConstIterator it = annots.begin(), itEnd = annots.end();
         for ( ; it != itEnd; ++it )
         {
@@ -279,23 +295,6 @@ void AnnotationModelPrivate::rebuildTree( const QVector< Okular::Page * > &pages
     emit q->layoutChanged();
 }
 
-AnnItem* AnnotationModelPrivate::findItem( int page, int *index ) const
-{
-    for ( int i = 0; i < root->children.count(); ++i )
-    {
-        AnnItem *tmp = root->children.at( i );
-        if ( tmp->page == page )
-        {
-            if ( index )
-                *index = i;
-            return tmp;
-        }
-    }
-    if ( index )
-        *index = -1;
-    return nullptr;
-}
-
 
 AnnotationModel::AnnotationModel( Okular::Document *document, QObject *parent )
     : QAbstractItemModel( parent ), d( new AnnotationModelPrivate( this ) )
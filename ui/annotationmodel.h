@@ -12,6 +12,8 @@
 
 #include <qabstractitemmodel.h>
 
+#include "okularpart_export.h"
+
 namespace Okular {
 class Annotation;
 class Document;
@@ -19,7 +21,7 @@ class Document;
 
 class AnnotationModelPrivate;
 
-class AnnotationModel : public QAbstractItemModel
+class OKULARPART_EXPORT AnnotationModel : public QAbstractItemModel
 {
     Q_OBJECT
 
@@ -9,6 +9,7 @@
 
 #include "annotationproxymodels.h"
 
+#include <QHash>
 #include <QList>
 #include <QItemSelection>
 
@@ -162,12 +163,11 @@ QModelIndex PageGroupProxyModel::mapFromSource( const QModelIndex &sourceIndex )
       return index( sourceIndex.row(), sourceIndex.column() );
     }
   } else {
-    for ( int i = 0; i < mIndexes.count(); ++i ) {
-      if ( mIndexes[ i ] == sourceIndex )
-        return index( i, 0 );
-    }
+    const int row = mIndexRows.value( sourceIndex, -1 );
+    if ( row == -1 )
+      return QModelIndex();
 
-    return QModelIndex();
+    return index( row, 0 );
   }
 }
 
@@ -239,11 +239,14 @@ void PageGroupProxyModel::rebuildIndexes()
     }
   } else {
     mIndexes.clear();
+    mIndexRows.clear();
 
     for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
       const QModelIndex pageIndex = sourceModel()->index( row, 0 );
       for ( int subRow = 0; subRow < sourceModel()->rowCount( pageIndex ); ++subRow ) {
-        mIndexes.append( sourceModel()->index( subRow, 0, pageIndex ) );
+        const QModelIndex itemIndex = sourceModel()->index( subRow, 0, pageIndex );
+        mIndexRows.insert( itemIndex, mIndexes.count() );
+        mIndexes.append( itemIndex );
       }
     }
   }
@@ -278,7 +281,7 @@ class AuthorGroupItem
         };
 
         AuthorGroupItem( AuthorGroupItem *parent, Type type = Page, const QModelIndex &index = QModelIndex() )
-            : mParent( parent ), mType( type ), mIndex( index )
+            : mParent( parent ), mType( type ), mIndex( index ), mRow( 0 )
         {
         }
 
@@ -287,7 +290,7 @@ class AuthorGroupItem
             qDeleteAll( mChilds );
         }
 
-        void appendChild( AuthorGroupItem *child ) { mChilds.append( child ); }
+        void appendChild( AuthorGroupItem *child ) { child->mRow = mChilds.count(); mChilds.append( child ); }
         AuthorGroupItem* parent() const { return mParent; }
         AuthorGroupItem* child( int row ) const { return mChilds.value( row ); }
         int childCount() const { return mChilds.count(); }
@@ -303,23 +306,18 @@ class AuthorGroupItem
                 mChilds[ i ]->dump( level + 2 );
         }
 
-        const AuthorGroupItem* findIndex( const QModelIndex &index ) const
+        void collectIndexes( QHash<QModelIndex, AuthorGroupItem*> &items )
         {
-            if ( index == mIndex )
-                return this;
+            if ( mIndex.isValid() )
+                items.insert( mIndex, this );
 
-            for ( int i = 0; i < mChilds.count(); ++i ) {
-                const AuthorGroupItem *item = mChilds[ i ]->findIndex( index );
-                if ( item )
-                    return item;
-            }
-
-            return nullptr;
+            for ( int i = 0; i < mChilds.count(); ++i )
+                mChilds[ i ]->collectIndexes( items );
         }
 
         int row() const
         {
-            return ( mParent ? mParent->mChilds.indexOf( const_cast<AuthorGroupItem*>( this ) ) : 0 );
+            return mRow;
         }
 
         Type type() const { return mType; }
@@ -334,6 +332,7 @@ class AuthorGroupItem
         QModelIndex mIndex;
         QList<AuthorGroupItem*> mChilds;
         QString mAuthor;
+        int mRow;
 };
 
 class AuthorGroupProxyModel::Private
@@ -351,6 +350,8 @@ class AuthorGroupProxyModel::Private
 
         AuthorGroupProxyModel *mParent;
         AuthorGroupItem *mRoot;
+        // the items of the tree, by the source index they map to
+        QHash<QModelIndex, AuthorGroupItem*> mItems;
         bool mGroupByAuthor;
 };
 
@@ -418,11 +419,11 @@ QModelIndex AuthorGroupProxyModel::mapFromSource( const QModelIndex &sourceIndex
     if ( !sourceIndex.isValid() )
         return QModelIndex();
 
-    const AuthorGroupItem *item = d->mRoot->findIndex( sourceIndex );
+    AuthorGroupItem *item = d->mItems.value( sourceIndex );
     if ( !item )
         return QModelIndex();
 
-    return createIndex( item->row(), 0, const_cast<AuthorGroupItem*>( item ) );
+    return createIndex( item->row(), 0, item );
 }
 
 QModelIndex AuthorGroupProxyModel::mapToSource( const QModelIndex &proxyIndex ) const
@@ -531,9 +532,10 @@ void AuthorGroupProxyModel::rebuildIndexes()
     beginResetModel();
     delete d->mRoot;
     d->mRoot = new AuthorGroupItem( nullptr );
+    d->mItems.clear();
 
     if ( d->mGroupByAuthor ) {
-        QMap<QString, AuthorGroupItem*> authorMap;
+        QHash<QString, AuthorGroupItem*> authorMap;
 
         for ( int row = 0; row < sourceModel()->rowCount(); ++row ) {
             const QModelIndex idx = sourceModel()->index( row, 0 );
@@ -562,7 +564,7 @@ void AuthorGroupProxyModel::rebuildIndexes()
                 d->mRoot->appendChild( pageItem );
 
                 // First collect all authors...
-                QMap<QString, AuthorGroupItem*> pageAuthorMap;
+                QHash<QString, AuthorGroupItem*> pageAuthorMap;
                 for ( int subRow = 0; subRow < sourceModel()->rowCount( idx ); ++subRow ) {
                     const QModelIndex annIdx = sourceModel()->index( subRow, 0, idx );
                     const QString author = sourceModel()->data( annIdx, AnnotationModel::AuthorRole ).toString();
@@ -607,6 +609,8 @@ void AuthorGroupProxyModel::rebuildIndexes()
         }
     }
 
+    d->mRoot->collectIndexes( d->mItems );
+
     endResetModel();
 }
 
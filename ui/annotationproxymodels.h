@@ -11,6 +11,7 @@
 #define ANNOTATIONPROXYMODEL_H
 
 #include <QSortFilterProxyModel>
+#include <QHash>
 #include <QPair>
 
 /**
@@ -92,6 +93,7 @@ class PageGroupProxyModel : public QAbstractProxyModel
   private:
     bool mGroupByPage;
     QList<QModelIndex> mIndexes;
+    QHash<QModelIndex, int> mIndexRows;
     QList<QPair< QModelIndex, QList<QModelIndex> > > mTreeIndexes;
 };
 
@@ -0,0 +1,459 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "codebookmodel.h"
+
+#include <qhash.h>
+#include <qlinkedlist.h>
+#include <qlist.h>
+#include <qpixmap.h>
+#include <qpointer.h>
+#include <qvector.h>
+
+#include <QIcon>
+#include <KLocalizedString>
+
+#include "core/document.h"
+#include "core/observer.h"
+#include "core/page.h"
+#include "core/qdanodes.h"
+#include "core/tagging.h"
+
+struct CodebookItem
+{
+    CodebookItem();
+    CodebookItem( CodebookItem *parent, Okular::QDANode *node );
+    ~CodebookItem();
+
+    CodebookItem *parent;
+    QList< CodebookItem* > children;
+
+    Okular::QDANode *node;
+    int row;
+    int count;
+};
+
+typedef QHash< Okular::QDANode*, int > CodingCounts;
+
+class CodebookModelPrivate : public Okular::DocumentObserver
+{
+public:
+    CodebookModelPrivate( CodebookModel *qq );
+    ~CodebookModelPrivate() override;
+
+    void notifySetup( const QVector< Okular::Page * > &pages, int setupFlags ) override;
+    void notifyPageChanged( int page, int flags ) override;
+
+    QModelIndex indexForItem( CodebookItem *item, int column = 0 ) const;
+    void rebuildTree();
+    void refreshNodeNames();
+    CodebookItem* addItem( Okular::QDANode *node, bool notify );
+    Okular::QDANode* attributeParent( Okular::QDANode *node ) const;
+    Okular::QDANode* parentNode( Okular::QDANode *node ) const;
+
+    CodebookModel *q;
+    CodebookItem *root;
+    // the items of the tree, by node
+    QHash< Okular::QDANode*, CodebookItem* > items;
+    QHash< QString, Okular::QDANode* > nodesByUniqueName;
+    QHash< QString, Okular::QDANode* > nodesByName;
+    // the codings of each page, so a page change is applied as a delta
+    QVector< CodingCounts > pageCounts;
+    QPointer< Okular::Document > document;
+};
+
+// the number of codings of each node on the page; a coding spanning
+// several pages only counts on the page of its head
+static CodingCounts countCodings( const Okular::Page *page )
+{
+    CodingCounts counts;
+    foreach ( Okular::Tagging *tagging, page->taggings() )
+    {
+        if ( tagging->head() == tagging && tagging->node() )
+            counts[ tagging->node() ]++;
+    }
+    return counts;
+}
+
+
+CodebookItem::CodebookItem()
+    : parent( nullptr ), node( nullptr ), row( 0 ), count( 0 )
+{
+}
+
+CodebookItem::CodebookItem( CodebookItem *_parent, Okular::QDANode *_node )
+    : parent( _parent ), node( _node ), row( _parent->children.count() ), count( 0 )
+{
+    parent->children.append( this );
+}
+
+CodebookItem::~CodebookItem()
+{
+    qDeleteAll( children );
+}
+
+
+CodebookModelPrivate::CodebookModelPrivate( CodebookModel *qq )
+    : q( qq ), root( new CodebookItem )
+{
+}
+
+CodebookModelPrivate::~CodebookModelPrivate()
+{
+    delete root;
+}
+
+void CodebookModelPrivate::notifySetup( const QVector< Okular::Page * > &pages, int setupFlags )
+{
+    if ( !( setupFlags & Okular::DocumentObserver::DocumentChanged ) )
+        return;
+
+    q->beginResetModel();
+    pageCounts.clear();
+    pageCounts.reserve( pages.count() );
+    foreach ( const Okular::Page *page, pages )
+        pageCounts.append( countCodings( page ) );
+
+    rebuildTree();
+    q->endResetModel();
+}
+
+void CodebookModelPrivate::notifyPageChanged( int page, int flags )
+{
+    // we are strictly interested in taggings
+    if ( !( flags & Okular::DocumentObserver::Taggings ) || page < 0 || page >= pageCounts.count() )
+        return;
+
+    const CodingCounts oldCounts = pageCounts.at( page );
+    const CodingCounts newCounts = countCodings( document->page( page ) );
+    pageCounts[ page ] = newCounts;
+
+    // the nodes of the page may have been renamed or moved, so they are
+    // refreshed even if their count did not change
+    QList< Okular::QDANode* > touched = oldCounts.keys();
+    for ( CodingCounts::const_iterator it = newCounts.constBegin(); it != newCounts.constEnd(); ++it )
+    {
+        if ( !oldCounts.contains( it.key() ) )
+            touched.append( it.key() );
+    }
+
+    // a node we have not seen yet may name a parent we have not seen either
+    foreach ( Okular::QDANode *node, touched )
+    {
+        if ( !items.contains( node ) )
+        {
+            refreshNodeNames();
+            break;
+        }
+    }
+
+    foreach ( Okular::QDANode *node, touched )
+    {
+        nodesByName.insert( node->name(), node );
+
+        CodebookItem *item = items.value( node );
+        if ( !item )
+            continue;
+
+        // a new parent moves the node around in the tree: this is rare
+        // enough to just start over
+        CodebookItem *parentItem = items.value( parentNode( node ), root );
+        if ( item->parent != parentItem )
+        {
+            q->beginResetModel();
+            rebuildTree();
+            q->endResetModel();
+            return;
+        }
+    }
+
+    foreach ( Okular::QDANode *node, touched )
+    {
+        CodebookItem *item = items.value( node );
+        if ( !item )
+            item = addItem( node, true );
+
+        item->count += newCounts.value( node ) - oldCounts.value( node );
+        emit q->dataChanged( indexForItem( item, 0 ), indexForItem( item, 1 ) );
+    }
+}
+
+QModelIndex CodebookModelPrivate::indexForItem( CodebookItem *item, int column ) const
+{
+    if ( item->parent )
+        return q->createIndex( item->row, column, item );
+    return QModelIndex();
+}
+
+void CodebookModelPrivate::rebuildTree()
+{
+    qDeleteAll( root->children );
+    root->children.clear();
+    items.clear();
+    refreshNodeNames();
+
+    CodingCounts counts;
+    foreach ( const CodingCounts &page, pageCounts )
+    {
+        for ( CodingCounts::const_iterator it = page.constBegin(); it != page.constEnd(); ++it )
+            counts[ it.key() ] += it.value();
+    }
+
+    foreach ( Okular::QDANode *node, Okular::QDANodeUtils::QDANodes )
+    {
+        if ( !items.contains( node ) )
+            addItem( node, false );
+        items.value( node )->count = counts.value( node );
+    }
+}
+
+void CodebookModelPrivate::refreshNodeNames()
+{
+    nodesByUniqueName.clear();
+    nodesByName.clear();
+
+    foreach ( Okular::QDANode *node, Okular::QDANodeUtils::QDANodes )
+    {
+        nodesByUniqueName.insert( node->uniqueName(), node );
+        nodesByName.insert( node->name(), node );
+    }
+}
+
+CodebookItem* CodebookModelPrivate::addItem( Okular::QDANode *node, bool notify )
+{
+    // the parent goes in first, so the new item always has a place to go
+    Okular::QDANode *parent = parentNode( node );
+    CodebookItem *parentItem = root;
+    if ( parent )
+    {
+        parentItem = items.value( parent );
+        if ( !parentItem )
+            parentItem = addItem( parent, notify );
+    }
+
+    nodesByUniqueName.insert( node->uniqueName(), node );
+    nodesByName.insert( node->name(), node );
+
+    const int row = parentItem->children.count();
+    if ( notify )
+        q->beginInsertRows( indexForItem( parentItem ), row, row );
+    CodebookItem *item = new CodebookItem( parentItem, node );
+    items.insert( node, item );
+    if ( notify )
+        q->endInsertRows();
+    return item;
+}
+
+Okular::QDANode* CodebookModelPrivate::attributeParent( Okular::QDANode *node ) const
+{
+    typedef QPair< QString, QString > Attribute;
+    foreach ( const Attribute &attribute, node->attributes )
+    {
+        if ( attribute.first.compare( QLatin1String( "parent" ), Qt::CaseInsensitive ) != 0 )
+            continue;
+
+        Okular::QDANode *parent = nodesByUniqueName.value( attribute.second );
+        if ( !parent )
+        {
+            // names can change, so only trust the ones that still match
+            parent = nodesByName.value( attribute.second );
+            if ( parent && parent->name() != attribute.second )
+                parent = nullptr;
+        }
+        return parent;
+    }
+    return nullptr;
+}
+
+Okular::QDANode* CodebookModelPrivate::parentNode( Okular::QDANode *node ) const
+{
+    Okular::QDANode *parent = attributeParent( node );
+
+    // codes that end up nested below themselves are shown at top level
+    const int maxDepth = Okular::QDANodeUtils::QDANodes.count();
+    int depth = 0;
+    for ( Okular::QDANode *ancestor = parent; ancestor; ancestor = attributeParent( ancestor ) )
+    {
+        if ( ancestor == node || ++depth > maxDepth )
+            return nullptr;
+    }
+    return parent;
+}
+
+
+CodebookModel::CodebookModel( Okular::Document *document, QObject *parent )
+    : QAbstractItemModel( parent ), d( new CodebookModelPrivate( this ) )
+{
+    d->document = document;
+
+    d->document->addObserver( d );
+}
+
+CodebookModel::~CodebookModel()
+{
+    if ( d->document )
+        d->document->removeObserver( d );
+
+    delete d;
+}
+
+int CodebookModel::columnCount( const QModelIndex &parent ) const
+{
+    Q_UNUSED( parent )
+    return 2;
+}
+
+QVariant CodebookModel::data( const QModelIndex &index, int role ) const
+{
+    if ( !index.isValid() )
+        return QVariant();
+
+    CodebookItem *item = static_cast< CodebookItem* >( index.internalPointer() );
+    switch ( role )
+    {
+        case Qt::DisplayRole:
+            if ( index.column() == 1 )
+                return item->count;
+            return item->node->name().isEmpty() ? i18nc( "QDA node without a name", "Unnamed" ) : item->node->name();
+            break;
+        case Qt::DecorationRole:
+            if ( index.column() == 0 )
+            {
+                QPixmap pixmap( 16, 16 );
+                pixmap.fill( item->node->color() );
+                return QIcon( pixmap );
+            }
+            break;
+        case Qt::ToolTipRole:
+            if ( !item->node->author().isEmpty() )
+                return i18nc( "QDA node tooltip", "%1\nAuthor: %2\nCodings: %3", item->node->name(), item->node->author(), item->count );
+            return i18nc( "QDA node tooltip", "%1\nCodings: %2", item->node->name(), item->count );
+            break;
+        case Qt::TextAlignmentRole:
+            if ( index.column() == 1 )
+                return Qt::AlignRight;
+            break;
+        case NodeRole:
+            return QVariant::fromValue< void * >( item->node );
+            break;
+        case CountRole:
+            return item->count;
+            break;
+    }
+    return QVariant();
+}
+
+bool CodebookModel::hasChildren( const QModelIndex &parent ) const
+{
+    if ( !parent.isValid() )
+        return true;
+
+    if ( parent.column() != 0 )
+        return false;
+
+    CodebookItem *item = static_cast< CodebookItem* >( parent.internalPointer() );
+    return !item->children.isEmpty();
+}
+
+QVariant CodebookModel::headerData( int section, Qt::Orientation orientation, int role ) const
+{
+    if ( orientation != Qt::Horizontal || role != Qt::DisplayRole )
+        return QVariant();
+
+    if ( section == 0 )
+        return i18nc( "QDA node name", "Node" );
+    if ( section == 1 )
+        return i18nc( "number of codings of a QDA node", "Codings" );
+
+    return QVariant();
+}
+
+QModelIndex CodebookModel::index( int row, int column, const QModelIndex &parent ) const
+{
+    if ( row < 0 || column < 0 || column > 1 || ( parent.isValid() && parent.column() != 0 ) )
+        return QModelIndex();
+
+    CodebookItem *item = parent.isValid() ? static_cast< CodebookItem* >( parent.internalPointer() ) : d->root;
+    if ( row < item->children.count() )
+        return createIndex( row, column, item->children.at( row ) );
+
+    return QModelIndex();
+}
+
+QModelIndex CodebookModel::parent( const QModelIndex &index ) const
+{
+    if ( !index.isValid() )
+        return QModelIndex();
+
+    CodebookItem *item = static_cast< CodebookItem* >( index.internalPointer() );
+    return d->indexForItem( item->parent );
+}
+
+int CodebookModel::rowCount( const QModelIndex &parent ) const
+{
+    if ( parent.isValid() && parent.column() != 0 )
+        return 0;
+
+    CodebookItem *item = parent.isValid() ? static_cast< CodebookItem* >( parent.internalPointer() ) : d->root;
+    return item->children.count();
+}
+
+Okular::QDANode* CodebookModel::nodeForIndex( const QModelIndex &index ) const
+{
+    if ( !index.isValid() )
+        return nullptr;
+
+    CodebookItem *item = static_cast< CodebookItem* >( index.internalPointer() );
+    return item->node;
+}
+
+QModelIndex CodebookModel::indexForNode( Okular::QDANode *node ) const
+{
+    CodebookItem *item = d->items.value( node );
+    return item ? d->indexForItem( item ) : QModelIndex();
+}
+
+int CodebookModel::nextCodingPage( Okular::QDANode *node, int page ) const
+{
+    const int pageCount = d->pageCounts.count();
+    for ( int i = 1; i <= pageCount; ++i )
+    {
+        const int candidate = ( page + i ) % pageCount;
+        if ( d->pageCounts.at( candidate ).contains( node ) )
+            return candidate;
+    }
+    return -1;
+}
+
+
+CodebookFilterProxyModel::CodebookFilterProxyModel( QObject *parent )
+    : QSortFilterProxyModel( parent )
+{
+    setFilterCaseSensitivity( Qt::CaseInsensitive );
+    setFilterKeyColumn( 0 );
+}
+
+bool CodebookFilterProxyModel::filterAcceptsRow( int row, const QModelIndex &sourceParent ) const
+{
+    if ( QSortFilterProxyModel::filterAcceptsRow( row, sourceParent ) )
+        return true;
+
+    // keep the parents of matching codes, so they stay reachable
+    const QModelIndex index = sourceModel()->index( row, 0, sourceParent );
+    const int childCount = sourceModel()->rowCount( index );
+    for ( int i = 0; i < childCount; ++i )
+    {
+        if ( filterAcceptsRow( i, index ) )
+            return true;
+    }
+
+    return false;
+}
+
+#include "moc_codebookmodel.cpp"
@@ -0,0 +1,84 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef CODEBOOKMODEL_H
+#define CODEBOOKMODEL_H
+
+#include <qabstractitemmodel.h>
+#include <QSortFilterProxyModel>
+
+#include "okularpart_export.h"
+
+namespace Okular {
+class Document;
+class QDANode;
+}
+
+class CodebookModelPrivate;
+
+/**
+ * A model of the QDA codebook: one item per node, nested below the node
+ * named by its "parent" attribute, with the number of codings of each
+ * node in the second column.
+ */
+class OKULARPART_EXPORT CodebookModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+    public:
+        enum {
+            NodeRole = Qt::UserRole + 1000,
+            CountRole
+        };
+
+        explicit CodebookModel( Okular::Document *document, QObject *parent = nullptr );
+        virtual ~CodebookModel();
+
+        // reimplementations from QAbstractItemModel
+        int columnCount( const QModelIndex &parent = QModelIndex() ) const override;
+        QVariant data( const QModelIndex &index, int role = Qt::DisplayRole ) const override;
+        bool hasChildren( const QModelIndex &parent = QModelIndex() ) const override;
+        QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
+        QModelIndex index( int row, int column, const QModelIndex &parent = QModelIndex() ) const override;
+        QModelIndex parent( const QModelIndex &index ) const override;
+        int rowCount( const QModelIndex &parent = QModelIndex() ) const override;
+
+        Okular::QDANode* nodeForIndex( const QModelIndex &index ) const;
+        QModelIndex indexForNode( Okular::QDANode *node ) const;
+
+        /**
+         * Returns the first page after @p page with a coding of @p node,
+         * wrapping around at the end of the document, or -1 if there is none.
+         */
+        int nextCodingPage( Okular::QDANode *node, int page ) const;
+
+    private:
+        // storage
+        friend class CodebookModelPrivate;
+        CodebookModelPrivate *const d;
+};
+
+/**
+ * A proxy model, which keeps the codes whose name matches the filter
+ * together with all their ancestors.
+ */
+class OKULARPART_EXPORT CodebookFilterProxyModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+    public:
+        explicit CodebookFilterProxyModel( QObject *parent = nullptr );
+
+        /**
+         * Reimplemented from QSortFilterProxy.
+         */
+        bool filterAcceptsRow( int row, const QModelIndex &sourceParent ) const override;
+};
+
+#endif
@@ -21,17 +21,23 @@
 
 #include <QPainter>
 
+#include <math.h>
+
 #include "core/document.h"
 #include "core/generator.h"
 #include "pagepainter.h"
 #include "priorities.h"
 
 static const int SCALE = 10;
+// once the page is tiled, the magnified page is requested in cells of this
+// many pixels, so moving the cursor only renders what comes into view
+static const int CELL_SIZE = 512;
 
 MagnifierView::MagnifierView(Okular::Document* document, QWidget* parent)
   : QWidget(parent)
   , m_document(document)
   , m_page(nullptr)
+  , m_current(-1)
 {
   document->addObserver(this);
 }
@@ -64,6 +70,8 @@ void MagnifierView::notifyPageChanged(int page, int flags)
 
 bool MagnifierView::canUnloadPixmap(int page) const
 {
+  // the tiles of the page we were last on are kept while hidden, so showing
+  // us again there is instant; on low memory single tiles can still go
   return (page != m_current);
 }
 
@@ -121,35 +129,63 @@ void MagnifierView::move( int x, int y)
 
 void MagnifierView::requestPixmap()
 {
+  if (!m_page || !isVisible())
+    return;
+
   const int full_width = m_page->width() * SCALE;
   const int full_height = m_page->height() * SCALE;
 
   Okular::NormalizedRect nrect = normalizedView();
 
-  if (m_page && !m_page->hasPixmap( this, full_width, full_height, nrect ))
-  {
-    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
-
-    Okular::PixmapRequest *p = new Okular::PixmapRequest( this, m_current, full_width, full_height, PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous );
+  if (m_page->hasPixmap( this, full_width, full_height, nrect ))
+    return;
 
-    if ( m_page->hasTilesManager( this ) ) {
-      p->setTile( true );
-    }
+  // request a little bit bigger rectangle then currently viewed, but not the full scale page
+  const double rect_width = (nrect.right - nrect.left) * 0.5,
+               rect_height = (nrect.bottom - nrect.top) * 0.5;
 
-    // request a little bit bigger rectangle then currently viewed, but not the full scale page
-    const double rect_width = (nrect.right - nrect.left) * 0.5,
-                 rect_height = (nrect.bottom - nrect.top) * 0.5;
+  const double top = qMax(nrect.top - rect_height, 0.0);
+  const double bottom = qMin(nrect.bottom + rect_height, 1.0);
+  const double left = qMax(nrect.left - rect_width, 0.0);
+  const double right = qMin(nrect.right + rect_width, 1.0);
 
-    const double top = qMax(nrect.top - rect_height, 0.0);
-    const double bottom = qMin(nrect.bottom + rect_height, 1.0);
-    const double left = qMax(nrect.left - rect_width, 0.0);
-    const double right = qMin(nrect.right + rect_width, 1.0);
+  QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
 
+  if ( !m_page->hasTilesManager( this ) ) {
+    // the document switches to tiles by itself when the page is big enough
+    Okular::PixmapRequest *p = new Okular::PixmapRequest( this, m_current, full_width, full_height, PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous );
     p->setNormalizedRect( Okular::NormalizedRect(left, top, right, bottom) );
     requestedPixmaps.push_back( p );
-
-    m_document->requestPixmaps( requestedPixmaps );
+  } else {
+    // request the cells that are missing, the visible ones first
+    const double cell_width = (double)CELL_SIZE / full_width;
+    const double cell_height = (double)CELL_SIZE / full_height;
+    const int first_column = (int)(left / cell_width);
+    const int last_column = qMax(first_column, (int)ceil(right / cell_width) - 1);
+    const int first_row = (int)(top / cell_height);
+    const int last_row = qMax(first_row, (int)ceil(bottom / cell_height) - 1);
+
+    for (int row = first_row; row <= last_row; ++row) {
+      for (int column = first_column; column <= last_column; ++column) {
+        const Okular::NormalizedRect cell(column * cell_width, row * cell_height,
+                                          qMin((column + 1) * cell_width, 1.0), qMin((row + 1) * cell_height, 1.0));
+        if (m_page->hasPixmap( this, full_width, full_height, cell ))
+          continue;
+
+        const bool visible = cell.intersects( nrect );
+        Okular::PixmapRequest *p = new Okular::PixmapRequest( this, m_current, full_width, full_height, visible ? PAGEVIEW_PRIO : PAGEVIEW_PRELOAD_PRIO, Okular::PixmapRequest::Asynchronous );
+        p->setTile( true );
+        p->setNormalizedRect( cell );
+        if (visible)
+          requestedPixmaps.push_front( p );
+        else
+          requestedPixmaps.push_back( p );
+      }
+    }
   }
+
+  // replaces our requests for the cells we moved away from
+  m_document->requestPixmaps( requestedPixmaps );
 }
 
 Okular::NormalizedRect MagnifierView::normalizedView() const
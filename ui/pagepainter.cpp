@@ -10,6 +10,7 @@
 #include "pagepainter.h"
 
 // qt / kde includes
+#include <qcache.h>
 #include <qrect.h>
 #include <qpainter.h>
 #include <qpalette.h>
@@ -41,6 +42,80 @@ Q_GLOBAL_STATIC_WITH_ARGS( QPixmap, busyPixmap, ( KIconLoader::global()->loadIco
 
 #define TEXTANNOTATION_ICONSIZE 24
 
+// page pixmaps and tiles with the accessibility colors applied, see
+// accessiblePixmap(): one per observer, page and tile, which is replaced
+// when the original pixmap is
+struct AccessibilityCacheKey
+{
+    const Okular::DocumentObserver *observer;
+    int page;
+    Okular::NormalizedRect rect;
+
+    bool operator==( const AccessibilityCacheKey &other ) const
+    {
+        return observer == other.observer && page == other.page && rect == other.rect;
+    }
+};
+
+inline uint qHash( const AccessibilityCacheKey &key, uint seed = 0 )
+{
+    return qHash( key.observer, seed ) ^ qHash( key.page ) ^ qHash( key.rect.left ) ^ qHash( key.rect.top )
+        ^ qHash( key.rect.right ) ^ qHash( key.rect.bottom );
+}
+
+struct AccessiblePixmap
+{
+    qint64 pixmapKey;
+    QPixmap pixmap;
+};
+
+struct AccessibilitySettings
+{
+    int mode;
+    QRgb foreground;
+    QRgb background;
+    int contrast;
+    int threshold;
+
+    bool operator==( const AccessibilitySettings &other ) const
+    {
+        return mode == other.mode && foreground == other.foreground && background == other.background
+            && contrast == other.contrast && threshold == other.threshold;
+    }
+};
+
+struct AccessibilityCache
+{
+    AccessibilityCache()
+    {
+        const AccessibilitySettings none = { -1, 0, 0, 0, 0 };
+        settings = none;
+    }
+
+    QCache<AccessibilityCacheKey, AccessiblePixmap> pixmaps;
+    // the settings all the cached pixmaps were made with
+    AccessibilitySettings settings;
+};
+Q_GLOBAL_STATIC( AccessibilityCache, accessibilityCache )
+
+// in KB, for the pixmaps the document keeps at the given memory level:
+// none on Low, the visible pages of a full HD screen on Normal, of a 4K
+// one above
+static int accessibilityCacheSize()
+{
+    switch ( Okular::SettingsCore::memoryLevel() )
+    {
+        case Okular::SettingsCore::EnumMemoryLevel::Low:
+            return 0;
+        case Okular::SettingsCore::EnumMemoryLevel::Normal:
+            return 32 * 1024;
+        case Okular::SettingsCore::EnumMemoryLevel::Aggressive:
+        case Okular::SettingsCore::EnumMemoryLevel::Greedy:
+            return 192 * 1024;
+    }
+    return 0;
+}
+
 inline QPen buildPen( const Okular::Annotation *ann, double width, const QColor &color )
 {
     QPen p(
@@ -53,6 +128,20 @@ inline QPen buildPen( const Okular::Annotation *ann, double width, const QColor
     return p;
 }
 
+// Draws the part of the page inside dLimitsInPixmap (device pixels of the page
+// scaled to dScaledWidth x dScaledHeight) into target. A pixmap of another size,
+// like the one of the previous zoom level, is scaled while drawing instead of
+// making a scaled copy of the whole page first.
+inline void drawPagePixmap( QPainter * painter, const QRectF & target, const QPixmap & pixmap,
+                            const QRect & dLimitsInPixmap, int dScaledWidth, int dScaledHeight )
+{
+    const double xScale = pixmap.width() / (double)dScaledWidth;
+    const double yScale = pixmap.height() / (double)dScaledHeight;
+    const QRectF source( dLimitsInPixmap.x() * xScale, dLimitsInPixmap.y() * yScale,
+                         dLimitsInPixmap.width() * xScale, dLimitsInPixmap.height() * yScale );
+    painter->drawPixmap( target, pixmap, source );
+}
+
 void PagePainter::paintPageOnPainter( QPainter * destPainter, const Okular::Page * page,
     Okular::DocumentObserver *observer, int flags, int scaledWidth, int scaledHeight, const QRect &limits )
 {
@@ -103,6 +192,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
     const bool hasTilesManager = page->hasTilesManager( observer );
     QPixmap pixmap;
+    qint64 pixmapKey = 0;
 
     if ( !hasTilesManager )
     {
@@ -110,6 +200,8 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         const QPixmap *p = page->_o_nearestPixmap( observer, dScaledWidth, dScaledHeight );
 
         if (p != NULL) {
+            // the copy below gets a new key when its ratio is changed
+            pixmapKey = p->cacheKey();
             pixmap = *p;
             pixmap.setDevicePixelRatio( qApp->devicePixelRatio() );
         }
@@ -273,7 +365,11 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
 
     /** 3 - ENABLE BACKBUFFERING IF DIRECT IMAGE MANIPULATION IS NEEDED **/
     bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
-    bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedAnnotations || bufferedTaggings || viewPortPoint;
+    // the colors are changed on the whole page pixmaps, which are cached, so
+    // they alone do not need a back buffer
+    if ( bufferAccessibility && !hasTilesManager )
+        pixmap = accessiblePixmap( pixmap, pixmapKey, observer, page->number(), Okular::NormalizedRect() );
+    bool useBackBuffer = bufferedHighlights || bufferedAnnotations || bufferedTaggings || viewPortPoint;
     QPixmap * backPixmap = nullptr;
     QPainter * mixedPainter = nullptr;
     QRect limitsInPixmap = limits.translated( scaledCrop.topLeft() );
@@ -301,6 +397,12 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
                 {
                     QPixmap* tilePixmap = tile.pixmap();
                     tilePixmap->setDevicePixelRatio( qApp->devicePixelRatio() );
+                    QPixmap accessibleTile;
+                    if ( bufferAccessibility )
+                    {
+                        accessibleTile = accessiblePixmap( *tilePixmap, tilePixmap->cacheKey(), observer, page->number(), tile.rect() );
+                        tilePixmap = &accessibleTile;
+                    }
 
                     if ( tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height() ) {
                         destPainter->drawPixmap( limitsInTile.topLeft(), *tilePixmap,
@@ -314,9 +416,8 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         }
         else
         {
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
-            scaledCroppedPixmap.setDevicePixelRatio(dpr);
-            destPainter->drawPixmap( limits.topLeft(), scaledCroppedPixmap, QRectF(0, 0, dLimits.width(),dLimits.height()));
+            drawPagePixmap( destPainter, QRectF( limits.topLeft(), QSizeF( dLimits.width() / dpr, dLimits.height() / dpr ) ),
+                            pixmap, dLimitsInPixmap, dScaledWidth, dScaledHeight );
         }
 
         // 4A.2. active painter is the one passed to this method
@@ -328,7 +429,7 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         // the image over which we are going to draw
         QImage backImage = QImage( dLimits.width(), dLimits.height(), QImage::Format_ARGB32_Premultiplied );
         backImage.setDevicePixelRatio(dpr);
-        backImage.fill( paperColor );
+        backImage.fill( bufferAccessibility ? backgroundColor : paperColor );
         QPainter p( &backImage );
 
         if ( hasTilesManager )
@@ -348,6 +449,12 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
                 {
                     QPixmap* tilePixmap = tile.pixmap();
                     tilePixmap->setDevicePixelRatio( qApp->devicePixelRatio() );
+                    QPixmap accessibleTile;
+                    if ( bufferAccessibility )
+                    {
+                        accessibleTile = accessiblePixmap( *tilePixmap, tilePixmap->cacheKey(), observer, page->number(), tile.rect() );
+                        tilePixmap = &accessibleTile;
+                    }
 
                     if ( tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height() )
                     {
@@ -369,51 +476,12 @@ void PagePainter::paintCroppedPageOnPainter( QPainter * destPainter, const Okula
         else
         {
             // 4B.1. draw the page pixmap: normal or scaled
-            QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
-            scaledCroppedPixmap.setDevicePixelRatio(dpr);
-            p.drawPixmap( 0, 0, scaledCroppedPixmap );
+            drawPagePixmap( &p, QRectF( 0, 0, dLimits.width() / dpr, dLimits.height() / dpr ),
+                            pixmap, dLimitsInPixmap, dScaledWidth, dScaledHeight );
         }
 
         p.end();
 
-        // 4B.2. modify pixmap following accessibility settings
-        if ( bufferAccessibility )
-        {
-            switch ( Okular::SettingsCore::renderMode() )
-            {
-                case Okular::SettingsCore::EnumRenderMode::Inverted:
-                    // Invert image pixels using QImage internal function
-                    backImage.invertPixels(QImage::InvertRgb);
-                    break;
-                case Okular::SettingsCore::EnumRenderMode::Recolor:
-                    recolor(&backImage, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
-                    break;
-                case Okular::SettingsCore::EnumRenderMode::BlackWhite:
-                    // Manual Gray and Contrast
-                    unsigned int * data = (unsigned int *)backImage.bits();
-                    int val, pixels = backImage.width() * backImage.height(),
-                        con = Okular::Settings::bWContrast(), thr = 255 - Okular::Settings::bWThreshold();
-                    for( int i = 0; i < pixels; ++i )
-                    {
-                        val = qGray( data[i] );
-                        if ( val > thr )
-                            val = 128 + (127 * (val - thr)) / (255 - thr);
-                        else if ( val < thr )
-                            val = (128 * val) / thr;
-                        if ( con > 2 )
-                        {
-                            val = con * ( val - thr ) / 2 + thr;
-                            if ( val > 255 )
-                                val = 255;
-                            else if ( val < 0 )
-                                val = 0;
-                        }
-                        data[i] = qRgba( val, val, val, 255 );
-                    }
-                    break;
-            }
-        }
-
         // 4B.3. highlight rects in page
         if ( bufferedHighlights )
         {
@@ -960,17 +1028,132 @@ void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor
     const float scaleGreen = background.greenF() - foreground.greenF();
     const float scaleBlue = background.blueF() - foreground.blueF();
 
+    // the result only depends on the lightness, so compute it once per value
+    QRgb table[256];
+    for (int lightness = 0; lightness < 256; ++lightness) {
+        table[lightness] = qRgba(scaleRed * lightness + foreground.red(),
+                                 scaleGreen * lightness + foreground.green(),
+                                 scaleBlue * lightness + foreground.blue(),
+                                 0);
+    }
+
     for (int y=0; y<image->height(); y++) {
         QRgb *pixels = reinterpret_cast<QRgb*>(image->scanLine(y));
+        const int width = image->width();
+
+        for (int x=0; x<width; x++) {
+            const QRgb pixel = pixels[x];
+            pixels[x] = table[qGray(pixel)] | (pixel & 0xff000000);
+        }
+    }
+}
 
-        for (int x=0; x<image->width(); x++) {
-            const int lightness = qGray(pixels[x]);
-            pixels[x] = qRgba(scaleRed * lightness + foreground.red(),
-                           scaleGreen * lightness + foreground.green(),
-                           scaleBlue * lightness + foreground.blue(),
-                           qAlpha(pixels[x]));
+void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
+{
+    Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
+
+    // manual gray and contrast, tabulated by gray value
+    const int thr = 255 - threshold;
+    QRgb table[256];
+    for (int gray = 0; gray < 256; ++gray) {
+        int val = gray;
+        if ( val > thr )
+            val = 128 + (127 * (val - thr)) / (255 - thr);
+        else if ( val < thr )
+            val = (128 * val) / thr;
+        if ( contrast > 2 )
+        {
+            val = contrast * ( val - thr ) / 2 + thr;
+            if ( val > 255 )
+                val = 255;
+            else if ( val < 0 )
+                val = 0;
         }
+        table[gray] = qRgba( val, val, val, 255 );
+    }
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    const int pixels = image->width() * image->height();
+    for (int i = 0; i < pixels; ++i)
+        data[i] = table[qGray(data[i])];
+}
+
+void PagePainter::dropAccessiblePixmaps(int page)
+{
+    AccessibilityCache *cache = accessibilityCache();
+    if (page == -1) {
+        cache->pixmaps.clear();
+        return;
+    }
+
+    // the pixmap of a page may be painted for another observer too
+    const QList<AccessibilityCacheKey> keys = cache->pixmaps.keys();
+    for (const AccessibilityCacheKey &key : keys) {
+        if (key.page == page)
+            cache->pixmaps.remove(key);
+    }
+}
+
+QPixmap PagePainter::accessiblePixmap(const QPixmap &pixmap, qint64 pixmapKey, const Okular::DocumentObserver *observer,
+    int page, const Okular::NormalizedRect &rect)
+{
+    if (pixmap.isNull())
+        return pixmap;
+
+    const int mode = Okular::SettingsCore::renderMode();
+    AccessibilitySettings settings = { mode, 0, 0, 0, 0 };
+    if (mode == Okular::SettingsCore::EnumRenderMode::Recolor) {
+        settings.foreground = Okular::Settings::recolorForeground().rgba();
+        settings.background = Okular::Settings::recolorBackground().rgba();
+    } else if (mode == Okular::SettingsCore::EnumRenderMode::BlackWhite) {
+        settings.contrast = Okular::Settings::bWContrast();
+        settings.threshold = Okular::Settings::bWThreshold();
+    }
+
+    // what was made with other settings, or for a higher memory level, goes
+    AccessibilityCache *cache = accessibilityCache();
+    if (!(cache->settings == settings)) {
+        cache->pixmaps.clear();
+        cache->settings = settings;
+    }
+    cache->pixmaps.setMaxCost(accessibilityCacheSize());
+
+    // repaints while scrolling reuse the pixmap transformed the first time
+    const AccessibilityCacheKey key = { observer, page, rect };
+    if (const AccessiblePixmap *cached = cache->pixmaps.object(key)) {
+        if (cached->pixmapKey == pixmapKey)
+            return cached->pixmap;
+    }
+
+    QImage image = pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    switch (mode) {
+        case Okular::SettingsCore::EnumRenderMode::Inverted:
+            // Invert image pixels using QImage internal function
+            image.invertPixels(QImage::InvertRgb);
+            break;
+        case Okular::SettingsCore::EnumRenderMode::Recolor:
+            recolor(&image, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
+            break;
+        case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+            blackWhite(&image, settings.contrast, settings.threshold);
+            break;
+        default: ;
+    }
+
+    QPixmap result = QPixmap::fromImage(image);
+    result.setDevicePixelRatio(pixmap.devicePixelRatio());
+
+    // a stale copy made from the previous pixmap goes in any case
+    const int cost = qMax(1, result.width() * result.height() / 256);
+    if (cost <= cache->pixmaps.maxCost()) {
+        AccessiblePixmap *cached = new AccessiblePixmap;
+        cached->pixmapKey = pixmapKey;
+        cached->pixmap = result;
+        cache->pixmaps.insert(key, cached, cost);
+    } else {
+        cache->pixmaps.remove(key);
     }
+    return result;
 }
 
 /** Private Helpers :: Image Drawing **/
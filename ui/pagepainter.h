@@ -53,9 +53,20 @@ class Q_DECL_EXPORT PagePainter
             int flags, int scaledWidth, int scaledHeight, const QRect & pageLimits,
             const Okular::NormalizedRect & crop, Okular::NormalizedPoint *viewPortPoint );
 
+        // drop the pixmaps with the accessibility colors applied made from the
+        // pixmaps of 'page', or of all the pages if it is -1
+        static void dropAccessiblePixmaps( int page );
+
     private:
         static void cropPixmapOnImage( QImage & dest, const QPixmap * src, const QRect & r );
         static void recolor(QImage *image, const QColor &foreground, const QColor &background);
+        static void blackWhite(QImage *image, int contrast, int threshold);
+
+        // returns the page pixmap or tile with the accessibility colors applied,
+        // cached for the 'observer' by page and 'rect' of the tile as long as
+        // the original pixmap, of key 'pixmapKey', and the color settings last
+        static QPixmap accessiblePixmap(const QPixmap &pixmap, qint64 pixmapKey, const Okular::DocumentObserver *observer,
+            int page, const Okular::NormalizedRect &rect);
 
         // set the alpha component of the image to a given value
         static void changeImageAlpha( QImage & image, unsigned int alpha );
@@ -41,6 +41,7 @@
 #include <QMimeDatabase>
 #include <QMimeData>
 #include <QGestureEvent>
+#include <QElapsedTimer>
 
 #include <qaction.h>
 #include <kactionmenu.h>
@@ -60,6 +61,7 @@
 // system includes
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
 
 // local includes
 #include "debug_ui.h"
@@ -107,11 +109,35 @@ static const int pageflags = PagePainter::Accessibility | PagePainter::EnhanceLi
 
 static const float kZoomValues[] = { 0.12, 0.25, 0.33, 0.50, 0.66, 0.75, 1.00, 1.25, 1.50, 2.00, 4.00, 8.00, 16.00 };
 
+// scroll velocities, in pixels per millisecond, above which preloading
+// follows the direction of motion and visible pages are rendered smaller
+static const double kMovingScrollVelocity = 0.3;
+static const double kFastScrollVelocity = 3.0;
+// the velocity estimate is considered stale after this many milliseconds
+static const int kScrollVelocityTimeout = 150;
+// how far ahead (in milliseconds of scrolling) pages are preloaded
+static const int kPreloadLookAhead = 400;
+static const int kMaxExtraPreloadRows = 6;
+
 static inline double normClamp( double value, double def )
 {
     return ( value < 0.0 || value > 1.0 ) ? def : value;
 }
 
+// fills the Tag menu with the nodes of the codebook, each action carrying
+// its node as data, and returns the action that creates a new node
+static QAction * fillTagMenu( QMenu * tagMenu )
+{
+    foreach ( Okular::QDANode * node, Okular::QDANodeUtils::QDANodes )
+    {
+        QPixmap pixmap( 16, 16 );
+        pixmap.fill( node->color() );
+        QAction * tagSelection = tagMenu->addAction( QIcon( pixmap ), node->name() );
+        tagSelection->setData( QVariant::fromValue< void * >( node ) );
+    }
+    return tagMenu->addAction( QIcon::fromTheme( QStringLiteral("document-new") ), i18n("New") );
+}
+
 struct TableSelectionPart {
     PageViewItem * item;
     Okular::NormalizedRect rectInItem;
@@ -146,6 +172,28 @@ public:
     QLinkedList< PageViewItem * > visibleItems;
     MagnifierView *magnifierView;
 
+    // the rows of the current layout, sorted by y, so that the items in the
+    // viewport can be found by binary search; rebuilt by slotRelayoutPages()
+    struct LayoutRow
+    {
+        int top;
+        int bottom;
+        int firstItem;
+        int lastItem;
+    };
+    QVector< LayoutRow > layoutRows;
+
+    // vertical scroll velocity, in pixels per millisecond (positive when
+    // moving down), estimated in scrollContentsBy()
+    QElapsedTimer scrollClock;
+    double scrollVelocity;
+    // brings back full resolution once fast scrolling stops
+    QTimer * fastScrollTimer;
+    // the items whose form and video widgets were last placed in the viewport
+    int widgetsFirstItem;
+    int widgetsLastItem;
+    bool moveAllWidgets;
+
     // view layout (columns and continuous in Settings), zoom and mouse
     PageView::ZoomMode zoomMode;
     float zoomFactor;
@@ -334,6 +382,11 @@ PageView::PageView( QWidget *parent, Okular::Document *document )
     d->autoScrollTimer = nullptr;
     d->annotator = nullptr;
     d->dirtyLayout = false;
+    d->widgetsFirstItem = 0;
+    d->widgetsLastItem = -1;
+    d->moveAllWidgets = true;
+    d->scrollVelocity = 0.0;
+    d->fastScrollTimer = nullptr;
     d->blockViewport = false;
     d->blockPixmapsRequest = false;
     d->messageWindow = new PageViewMessage(this);
@@ -1184,6 +1237,7 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
                     // For the video widgets we don't really care about reusing them since they don't contain much info so just
                     // create them again
                     createAnnotationsVideoWidgets( item, pageSet[i]->annotations() );
+                    d->moveAllWidgets = true;
                     Q_FOREACH ( VideoWidget *vw, item->videoWidgets() )
                     {
                         const Okular::NormalizedRect r = vw->normGeometry();
@@ -1214,6 +1268,8 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
         delete *dIt;
     d->items.clear();
     d->visibleItems.clear();
+    d->layoutRows.clear();
+    d->moveAllWidgets = true;
     d->pagesWithTextSelection.clear();
     toggleFormWidgets( false );
     if ( d->formsWidgetController )
@@ -3137,16 +3193,7 @@ void PageView::mouseReleaseEvent( QMouseEvent * e )
             imageToFile = menu.addAction( QIcon::fromTheme(QStringLiteral("document-save")), i18n( "Save to File..." ) );
 
             QMenu * tagMenu = menu.addMenu ( i18n("Tag") );
-            QList< QAction * > * tagSelections = new QList< QAction * >();
-            QList< Okular::QDANode * >::const_iterator nIt = Okular::QDANodeUtils::QDANodes.constBegin(), nEnd = Okular::QDANodeUtils::QDANodes.constEnd();
-            for ( ; nIt != nEnd; ++nIt )
-            {
-                QPixmap pixmap(100,100);
-                pixmap.fill((*nIt)->color());
-                QAction * tagSelection = tagMenu->addAction ( QIcon(pixmap), (*nIt)->name() );
-                tagSelections->append( tagSelection );
-            }
-            QAction * newNode = tagMenu->addAction ( QIcon::fromTheme(QStringLiteral("document-new")), i18n("New") );
+            QAction * newNode = fillTagMenu( tagMenu );
 
             QAction *choice = menu.exec( e->globalPos() );
             // check if the user really selected an action
@@ -3214,20 +3261,8 @@ void PageView::mouseReleaseEvent( QMouseEvent * e )
                     Okular::QDANode * node = 0;
                     if ( choice == newNode )
                         node = new Okular::QDANode();
-                    else
-                    {
-                        QList< QAction * >::const_iterator aIt = tagSelections->constBegin(), aEnd = tagSelections->constEnd();
-                        QList< Okular::QDANode * >::const_iterator nIt = Okular::QDANodeUtils::QDANodes.constBegin();
-                        for ( ; aIt != aEnd; ++aIt )
-                        {
-                            if ( choice == *aIt )
-                            {
-                                node = *nIt;
-                                break;
-                            }
-                            nIt++;
-                        }
-                    }
+                    else if ( choice->parent() == tagMenu )
+                        node = static_cast< Okular::QDANode * >( choice->data().value< void * >() );
 
                     if (node)
                         d->createBoxTaggingsfromSelection( selectionRect, node );
@@ -3430,7 +3465,7 @@ void PageView::mouseReleaseEvent( QMouseEvent * e )
 #ifdef HAVE_SPEECH
                         QAction *speakText = nullptr;
 #endif
-                        QList< QAction * > * tagSelections = nullptr;
+                        QMenu * tagMenu = nullptr;
                         QAction * newNode = nullptr;
 
                         if ( (page = item->page())->textSelection() )
@@ -3467,17 +3502,8 @@ void PageView::mouseReleaseEvent( QMouseEvent * e )
                                 }
                             }
 
-                            QMenu * tagMenu = menu->addMenu ( i18n("Tag") );
-                            tagSelections = new QList< QAction * >();
-                            QList< Okular::QDANode * >::const_iterator nIt = Okular::QDANodeUtils::QDANodes.constBegin(), nEnd = Okular::QDANodeUtils::QDANodes.constEnd();
-                            for ( ; nIt != nEnd; ++nIt )
-                            {
-                                QPixmap pixmap(100,100);
-                                pixmap.fill((*nIt)->color());
-                                QAction * tagSelection = tagMenu->addAction ( QIcon(pixmap), (*nIt)->name() );
-                                tagSelections->append( tagSelection );
-                            }
-                            newNode = tagMenu->addAction ( QIcon::fromTheme(QStringLiteral("document-new")), i18n("New") );
+                            tagMenu = menu->addMenu ( i18n("Tag") );
+                            newNode = fillTagMenu( tagMenu );
                         }
 
                         if ( menu ) {
@@ -3503,20 +3529,8 @@ void PageView::mouseReleaseEvent( QMouseEvent * e )
                                 Okular::QDANode * node = 0;
                                 if ( choice == newNode )
                                     node = new Okular::QDANode();
-                                else
-                                {
-                                    QList< QAction * >::const_iterator aIt = tagSelections->constBegin(), aEnd = tagSelections->constEnd();
-                                    QList< Okular::QDANode * >::const_iterator nIt = Okular::QDANodeUtils::QDANodes.constBegin();
-                                    for ( ; aIt != aEnd; ++aIt )
-                                    {
-                                        if ( choice == *aIt )
-                                        {
-                                            node = *nIt;
-                                            break;
-                                        }
-                                        nIt++;
-                                    }
-                                }
+                                else if ( tagMenu && choice->parent() == tagMenu )
+                                    node = static_cast< Okular::QDANode * >( choice->data().value< void * >() );
 
                                 if (node)
                                     d->createTextTaggingsfromSelection( node );
@@ -3825,6 +3839,22 @@ bool PageView::viewportEvent( QEvent * e )
 
 void PageView::scrollContentsBy( int dx, int dy )
 {
+    // estimate the scroll velocity, smoothing over the last few steps
+    if ( dy != 0 )
+    {
+        const qint64 elapsed = d->scrollClock.isValid() ? d->scrollClock.restart() : -1;
+        if ( elapsed < 0 || elapsed > kScrollVelocityTimeout )
+        {
+            d->scrollClock.start();
+            d->scrollVelocity = 0.0;
+        }
+        else
+        {
+            const double velocity = -dy / (double)qMax( qint64( 1 ), elapsed );
+            d->scrollVelocity = 0.6 * d->scrollVelocity + 0.4 * velocity;
+        }
+    }
+
     const QRect r = viewport()->rect();
     viewport()->scroll( dx, dy, r );
     // HACK manually repaint the damaged regions, as it seems some updates are missed
@@ -4963,6 +4993,8 @@ void PageView::slotRelayoutPages()
             fullHeight = rowHeight[ pageRowIdx ];
 
         // 3) arrange widgets inside cells (and refine fullHeight if needed)
+        d->layoutRows.clear();
+        d->moveAllWidgets = true;
         int insertX = 0,
             insertY = fullHeight < viewportHeight ? ( viewportHeight - fullHeight ) / 2 : 0;
         const int origInsertY = insertY;
@@ -5013,9 +5045,20 @@ void PageView::slotRelayoutPages()
                         actualX = insertX + (cWidth - item->croppedWidth()) / 2;
                     }
                 }
-                item->moveTo( actualX,
-                              (continuousView ? insertY : origInsertY) + (rHeight - item->croppedHeight()) / 2 );
+                const int rowTop = continuousView ? insertY : origInsertY;
+                item->moveTo( actualX, rowTop + (rHeight - item->croppedHeight()) / 2 );
                 item->setVisible( true );
+
+                const int itemIndex = iIt - d->items.constBegin();
+                if ( d->layoutRows.isEmpty() || d->layoutRows.last().top != rowTop )
+                {
+                    const PageViewPrivate::LayoutRow row = { rowTop, rowTop + rHeight, itemIndex, itemIndex };
+                    d->layoutRows.append( row );
+                }
+                else
+                {
+                    d->layoutRows.last().lastItem = itemIndex;
+                }
             }
             else
             {
@@ -5088,7 +5131,7 @@ void PageView::delayedResizeEvent()
     slotRequestVisiblePixmaps();
 }
 
-static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const PageViewItem * i, const QRect &expandedViewportRect, QLinkedList< Okular::PixmapRequest * > *requestedPixmaps )
+static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const PageViewItem * i, const QRect &expandedViewportRect, QLinkedList< Okular::PixmapRequest * > *requestedPixmaps, int priority = PAGEVIEW_PRELOAD_PRIO )
 {
     Okular::NormalizedRect preRenderRegion;
     const QRect intersectionRect = expandedViewportRect.intersected( i->croppedGeometry() );
@@ -5103,7 +5146,7 @@ static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const
         const bool pageHasTilesManager = i->page()->hasTilesManager( observer );
         if ( pageHasTilesManager && !preRenderRegion.isNull() )
         {
-            Okular::PixmapRequest * p = new Okular::PixmapRequest( observer, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRELOAD_PRIO, requestFeatures );
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( observer, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), priority, requestFeatures );
             requestedPixmaps->push_back( p );
 
             p->setNormalizedRect( preRenderRegion );
@@ -5111,13 +5154,36 @@ static void slotRequestPreloadPixmap( Okular::DocumentObserver * observer, const
         }
         else if ( !pageHasTilesManager )
         {
-            Okular::PixmapRequest * p = new Okular::PixmapRequest( observer, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRELOAD_PRIO, requestFeatures );
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( observer, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), priority, requestFeatures );
             requestedPixmaps->push_back( p );
             p->setNormalizedRect( preRenderRegion );
         }
     }
 }
 
+static void moveItemWidgets( PageViewItem *i, const QRect &viewportRect, const QRect &viewportRectAtZeroZero )
+{
+    foreach( FormWidgetIface *fwi, i->formWidgets() )
+    {
+        Okular::NormalizedRect r = fwi->rect();
+        fwi->moveTo(
+            qRound( i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left ) + 1 - viewportRect.left(),
+            qRound( i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top ) + 1 - viewportRect.top() );
+    }
+    Q_FOREACH ( VideoWidget *vw, i->videoWidgets() )
+    {
+        const Okular::NormalizedRect r = vw->normGeometry();
+        vw->move(
+            qRound( i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left ) + 1 - viewportRect.left(),
+            qRound( i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top ) + 1 - viewportRect.top() );
+
+        if ( vw->isPlaying() && viewportRectAtZeroZero.intersected( vw->geometry() ).isEmpty() ) {
+            vw->stop();
+            vw->pageLeft();
+        }
+    }
+}
+
 void PageView::slotRequestVisiblePixmaps( int newValue )
 {
     // if requests are blocked (because raised by an unwanted event), exit
@@ -5141,33 +5207,64 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
     // Margin (in pixels) around the viewport to preload
     const int pixelsToExpand = 512;
 
-    // iterate over all items
-    d->visibleItems.clear();
-    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
-    QVector< Okular::VisiblePageRect * > visibleRects;
-    QVector< PageViewItem * >::const_iterator iIt = d->items.constBegin(), iEnd = d->items.constEnd();
-    for ( ; iIt != iEnd; ++iIt )
-    {
-        PageViewItem * i = *iIt;
-        foreach( FormWidgetIface *fwi, i->formWidgets() )
+    // current scroll velocity, a stale estimate means we stopped
+    const double scrollVelocity = d->scrollClock.isValid() && d->scrollClock.elapsed() <= kScrollVelocityTimeout ? d->scrollVelocity : 0.0;
+    const bool scrolling = qAbs( scrollVelocity ) > kMovingScrollVelocity;
+    const bool scrollingFast = qAbs( scrollVelocity ) > kFastScrollVelocity;
+    bool requestedReducedPixmaps = false;
+
+    // find the items in the rows crossing the viewport by binary search on
+    // the layout, falling back to all items while the layout is out of date
+    int firstItem = 0, lastItem = d->items.count() - 1;
+    if ( !d->dirtyLayout && !d->layoutRows.isEmpty() )
+    {
+        const auto rowBelowTop = []( const PageViewPrivate::LayoutRow &row, int y ) { return row.bottom <= y; };
+        QVector< PageViewPrivate::LayoutRow >::const_iterator rIt =
+            std::lower_bound( d->layoutRows.constBegin(), d->layoutRows.constEnd(), viewportRect.top(), rowBelowTop );
+        QVector< PageViewPrivate::LayoutRow >::const_iterator rLast = rIt;
+        while ( rLast != d->layoutRows.constEnd() && rLast->top <= viewportRect.bottom() )
+            ++rLast;
+        if ( rIt == rLast )
         {
-            Okular::NormalizedRect r = fwi->rect();
-            fwi->moveTo(
-                qRound( i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left ) + 1 - viewportRect.left(),
-                qRound( i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top ) + 1 - viewportRect.top() );
+            firstItem = 0;
+            lastItem = -1;
         }
-        Q_FOREACH ( VideoWidget *vw, i->videoWidgets() )
+        else
         {
-            const Okular::NormalizedRect r = vw->normGeometry();
-            vw->move(
-                qRound( i->uncroppedGeometry().left() + i->uncroppedWidth() * r.left ) + 1 - viewportRect.left(),
-                qRound( i->uncroppedGeometry().top() + i->uncroppedHeight() * r.top ) + 1 - viewportRect.top() );
-
-            if ( vw->isPlaying() && viewportRectAtZeroZero.intersected( vw->geometry() ).isEmpty() ) {
-                vw->stop();
-                vw->pageLeft();
-            }
+            firstItem = rIt->firstItem;
+            lastItem = (rLast - 1)->lastItem;
         }
+    }
+
+    // form and video widgets only need moving for the items in view now or
+    // last time; the others are placed out of the viewport already
+    if ( d->moveAllWidgets )
+    {
+        for ( PageViewItem *i : qAsConst( d->items ) )
+            moveItemWidgets( i, viewportRect, viewportRectAtZeroZero );
+        d->moveAllWidgets = false;
+    }
+    else
+    {
+        const int previousLast = qMin( d->widgetsLastItem, d->items.count() - 1 );
+        for ( int index = d->widgetsFirstItem; index <= previousLast; ++index )
+        {
+            if ( index < firstItem || index > lastItem )
+                moveItemWidgets( d->items[ index ], viewportRect, viewportRectAtZeroZero );
+        }
+        for ( int index = firstItem; index <= lastItem; ++index )
+            moveItemWidgets( d->items[ index ], viewportRect, viewportRectAtZeroZero );
+    }
+    d->widgetsFirstItem = firstItem;
+    d->widgetsLastItem = lastItem;
+
+    // iterate over the items in the viewport rows
+    d->visibleItems.clear();
+    QLinkedList< Okular::PixmapRequest * > requestedPixmaps;
+    QVector< Okular::VisiblePageRect * > visibleRects;
+    for ( int index = firstItem; index <= lastItem; ++index )
+    {
+        PageViewItem * i = d->items[ index ];
 
         if ( !i->isVisible() )
             continue;
@@ -5201,13 +5298,20 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
             expandedVisibleRect.bottom = qMin( 1.0, vItem->rect.bottom + rectMargin );
         }
 
+        // while scrolling fast, pages flying by are rendered at half size
+        const bool reducedPixmap = scrollingFast && !i->page()->hasTilesManager( this );
+        const int requestWidth = reducedPixmap ? qMax( 1, i->uncroppedWidth() / 2 ) : i->uncroppedWidth();
+        const int requestHeight = reducedPixmap ? qMax( 1, i->uncroppedHeight() / 2 ) : i->uncroppedHeight();
+
         // if the item has not the right pixmap, add a request for it
-        if ( !i->page()->hasPixmap( this, i->uncroppedWidth(), i->uncroppedHeight(), expandedVisibleRect ) )
+        if ( !i->page()->hasPixmap( this, i->uncroppedWidth(), i->uncroppedHeight(), expandedVisibleRect ) &&
+             !( reducedPixmap && i->page()->hasPixmap( this, requestWidth, requestHeight ) ) )
         {
 #ifdef PAGEVIEW_DEBUG
             kWarning() << "rerequesting visible pixmaps for page" << i->pageNumber() << "!";
 #endif
-            Okular::PixmapRequest * p = new Okular::PixmapRequest( this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous );
+            Okular::PixmapRequest * p = new Okular::PixmapRequest( this, i->pageNumber(), requestWidth, requestHeight, PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous );
+            requestedReducedPixmaps = requestedReducedPixmaps || reducedPixmap;
             requestedPixmaps.push_back( p );
 
             if ( i->page()->hasTilesManager( this ) )
@@ -5219,6 +5323,34 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
                 p->setNormalizedRect( vItem->rect );
         }
 
+        // on tiled pages, prefetch the tiles the scrolling is heading to
+        if ( scrolling && i->page()->hasTilesManager( this ) && Okular::Settings::memoryLevel() != Okular::Settings::EnumMemoryLevel::Low )
+        {
+            const double rectAhead = qAbs( scrollVelocity ) * kPreloadLookAhead / (double)i->uncroppedHeight();
+            Okular::NormalizedRect prefetchRect = expandedVisibleRect;
+            if ( scrollVelocity < 0 )
+            {
+                prefetchRect.top = qMax( 0.0, expandedVisibleRect.top - rectAhead );
+                prefetchRect.bottom = expandedVisibleRect.top;
+            }
+            else
+            {
+                prefetchRect.top = expandedVisibleRect.bottom;
+                prefetchRect.bottom = qMin( 1.0, expandedVisibleRect.bottom + rectAhead );
+            }
+
+            if ( prefetchRect.bottom > prefetchRect.top &&
+                 !i->page()->hasPixmap( this, i->uncroppedWidth(), i->uncroppedHeight(), prefetchRect ) )
+            {
+                Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Preload;
+                requestFeatures |= Okular::PixmapRequest::Asynchronous;
+                Okular::PixmapRequest * p = new Okular::PixmapRequest( this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), PAGEVIEW_PRELOAD_PRIO, requestFeatures );
+                requestedPixmaps.push_back( p );
+                p->setNormalizedRect( prefetchRect );
+                p->setTile( true );
+            }
+        }
+
         // look for the item closest to viewport center and the relative
         // position between the item and the viewport center
         if ( isEvent )
@@ -5252,22 +5384,44 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
         if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy)
             pagesToPreload = d->items.count();
 
-        const QRect expandedViewportRect = viewportRect.adjusted( 0, -pixelsToExpand, 0, pixelsToExpand );
+        // while scrolling, look further ahead in the direction of motion and
+        // care less (or not at all, when fast) about what is behind
+        const bool scrollingUp = scrollVelocity < 0;
+        int pagesAhead = pagesToPreload, pagesBehind = pagesToPreload;
+        int pixelsAhead = pixelsToExpand, pixelsBehind = pixelsToExpand;
+        int priorityBehind = PAGEVIEW_PRELOAD_PRIO;
+        if ( scrolling )
+        {
+            const int pixelsToTravel = int( qAbs( scrollVelocity ) * kPreloadLookAhead );
+            const int extraRows = qMin( kMaxExtraPreloadRows, pixelsToTravel / qMax( 1, viewport()->height() ) );
+            pagesAhead = qMin( pagesToPreload + extraRows * viewColumns(), d->items.count() );
+            pixelsAhead += pixelsToTravel;
+            pagesBehind = scrollingFast ? 0 : pagesToPreload;
+            pixelsBehind = scrollingFast ? 0 : pixelsToExpand;
+            priorityBehind = PAGEVIEW_PRELOAD_BEHIND_PRIO;
+        }
+        const int pagesAfter = scrollingUp ? pagesBehind : pagesAhead;
+        const int pagesBefore = scrollingUp ? pagesAhead : pagesBehind;
+        const int priorityAfter = scrollingUp ? priorityBehind : PAGEVIEW_PRELOAD_PRIO;
+        const int priorityBefore = scrollingUp ? PAGEVIEW_PRELOAD_PRIO : priorityBehind;
+
+        const QRect expandedViewportRect = viewportRect.adjusted( 0, -( scrollingUp ? pixelsAhead : pixelsBehind ),
+                                                                  0, scrollingUp ? pixelsBehind : pixelsAhead );
 
-        for( int j = 1; j <= pagesToPreload; j++ )
+        for( int j = 1; j <= qMax( pagesAfter, pagesBefore ); j++ )
         {
             // add the page after the 'visible series' in preload
             const int tailRequest = d->visibleItems.last()->pageNumber() + j;
-            if ( tailRequest < (int)d->items.count() )
+            if ( j <= pagesAfter && tailRequest < (int)d->items.count() )
             {
-                slotRequestPreloadPixmap( this, d->items[ tailRequest ], expandedViewportRect, &requestedPixmaps );
+                slotRequestPreloadPixmap( this, d->items[ tailRequest ], expandedViewportRect, &requestedPixmaps, priorityAfter );
             }
 
             // add the page before the 'visible series' in preload
             const int headRequest = d->visibleItems.first()->pageNumber() - j;
-            if ( headRequest >= 0 )
+            if ( j <= pagesBefore && headRequest >= 0 )
             {
-                slotRequestPreloadPixmap( this, d->items[ headRequest ], expandedViewportRect, &requestedPixmaps );
+                slotRequestPreloadPixmap( this, d->items[ headRequest ], expandedViewportRect, &requestedPixmaps, priorityBefore );
             }
 
             // stop if we've already reached both ends of the document
@@ -5276,6 +5430,18 @@ void PageView::slotRequestVisiblePixmaps( int newValue )
         }
     }
 
+    // ask again for full size pixmaps once the fast scrolling is over
+    if ( requestedReducedPixmaps )
+    {
+        if ( !d->fastScrollTimer )
+        {
+            d->fastScrollTimer = new QTimer( this );
+            d->fastScrollTimer->setSingleShot( true );
+            connect( d->fastScrollTimer, &QTimer::timeout, this, [this] { slotRequestVisiblePixmaps(); } );
+        }
+        d->fastScrollTimer->start( kScrollVelocityTimeout * 2 );
+    }
+
     // send requests to the document
     if ( !requestedPixmaps.isEmpty() )
     {
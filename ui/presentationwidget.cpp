@@ -29,6 +29,8 @@
 #include <qvalidator.h>
 #include <qapplication.h>
 #include <qdesktopwidget.h>
+#include <QScreen>
+#include <QWindow>
 #include <QGestureEvent>
 #include <kcursor.h>
 #include <krandom.h>
@@ -73,6 +75,11 @@
 // comment this to disable the top-right progress indicator
 #define ENABLE_PROGRESS_OVERLAY
 
+// slides rendered ahead of and behind the current one and pinned in the
+// pixmap cache, indexed by memory level (Low, Normal, Aggressive, Greedy)
+static const int kPrefetchAhead[] = { 0, 1, 3, 5 };
+static const int kPrefetchBehind[] = { 0, 1, 1, 2 };
+
 
 // a frame contains a pointer to the page object, its geometry and the
 // transition effect to the next frame
@@ -143,6 +150,7 @@ PresentationWidget::PresentationWidget( QWidget * parent, Okular::Document * doc
     : QWidget( nullptr /* must be null, to have an independent widget */, Qt::FramelessWindowHint ),
     m_pressedLink( nullptr ), m_handCursor( false ), m_drawingEngine( nullptr ),
     m_screenInhibitCookie(0), m_sleepInhibitFd(-1),
+    m_transitionDuration( 0 ), m_transitionRectCount( 0 ),
     m_parentWidget( parent ),
     m_document( doc ), m_frameIndex( -1 ), m_topBar( nullptr ), m_pagesEdit( nullptr ), m_searchBar( nullptr ),
     m_ac( collection ), m_screenSelect( nullptr ), m_isSetup( false ), m_blockNotifications( false ), m_inBlackScreenMode( false ),
@@ -243,10 +251,12 @@ PresentationWidget::PresentationWidget( QWidget * parent, Okular::Document * doc
     setContextMenuPolicy( Qt::PreventContextMenu );
     m_transitionTimer = new QTimer( this );
     m_transitionTimer->setSingleShot( true );
+    m_transitionTimer->setTimerType( Qt::PreciseTimer );
     connect(m_transitionTimer, &QTimer::timeout, this, &PresentationWidget::slotTransitionStep);
     m_overlayHideTimer = new QTimer( this );
     m_overlayHideTimer->setSingleShot( true );
     connect(m_overlayHideTimer, &QTimer::timeout, this, &PresentationWidget::slotHideOverlay);
+    m_prefetchClock.start();
     m_nextPageTimer = new QTimer( this );
     m_nextPageTimer->setSingleShot( true );
     connect(m_nextPageTimer, &QTimer::timeout, this, &PresentationWidget::slotNextPage);
@@ -398,6 +408,16 @@ void PresentationWidget::notifyPageChanged( int pageNumber, int changedFlags )
     if ( m_blockNotifications )
         return;
 
+    // report how long the slide took and if it beat the auto advance timer
+    if ( ( changedFlags & DocumentObserver::Pixmap ) && m_prefetchRequestTimes.contains( pageNumber ) && frameHasPixmap( pageNumber ) )
+    {
+        const qint64 latency = m_prefetchClock.elapsed() - m_prefetchRequestTimes.take( pageNumber );
+        if ( pageNumber == m_frameIndex + 1 && m_nextPageTimer->isActive() )
+            qCDebug(OkularUiDebug) << "Slide" << pageNumber + 1 << "rendered in" << latency << "ms," << m_nextPageTimer->remainingTime() << "ms before auto advance";
+        else
+            qCDebug(OkularUiDebug) << "Slide" << pageNumber + 1 << "rendered in" << latency << "ms";
+    }
+
     // check if it's the last requested pixmap. if so update the widget.
     if ( (changedFlags & ( DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights ) ) && pageNumber == m_frameIndex )
         generatePage( changedFlags & ( DocumentObserver::Annotations | DocumentObserver::Highlights ) );
@@ -440,19 +460,15 @@ void PresentationWidget::notifyCurrentPageChanged( int previousPage, int current
     {
         m_frameIndex = currentPage;
 
-        // check if pixmap exists or else request it
-        PresentationFrame * frame = m_frames[ m_frameIndex ];
-        int pixW = frame->geometry.width();
-        int pixH = frame->geometry.height();
-
         bool signalsBlocked = m_pagesEdit->signalsBlocked();
         m_pagesEdit->blockSignals( true );
         m_pagesEdit->setText( QString::number( m_frameIndex + 1 ) );
         m_pagesEdit->blockSignals( signalsBlocked );
 
         // if pixmap not inside the Okular::Page we request it and wait for
-        // notifyPixmapChanged call or else we can proceed to pixmap generation
-        if ( !frame->page->hasPixmap( this, ceil(pixW * qApp->devicePixelRatio()), ceil(pixH * qApp->devicePixelRatio()) ) )
+        // notifyPixmapChanged call or else we can proceed to pixmap generation;
+        // in both cases the neighbouring slides are prefetched
+        if ( !frameHasPixmap( m_frameIndex ) )
         {
             requestPixmaps();
         }
@@ -460,6 +476,7 @@ void PresentationWidget::notifyCurrentPageChanged( int previousPage, int current
         {
             // make the background pixmap
             generatePage();
+            requestPixmaps();
         }
 
         // perform the page opening action, if any
@@ -488,17 +505,25 @@ void PresentationWidget::notifyCurrentPageChanged( int previousPage, int current
 
 bool PresentationWidget::canUnloadPixmap( int pageNumber ) const
 {
-    if ( Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Low ||
-         Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Normal )
-    {
-        // can unload all pixmaps except for the currently visible one
-        return pageNumber != m_frameIndex;
-    }
-    else
-    {
-        // can unload all pixmaps except for the currently visible one, previous and next
-        return qAbs(pageNumber - m_frameIndex) <= 1;
-    }
+    // can unload all pixmaps except for the currently visible one and the
+    // prefetched slides around it
+    int first, last;
+    prefetchRange( first, last );
+    return pageNumber < first || pageNumber > last;
+}
+
+void PresentationWidget::prefetchRange( int &first, int &last ) const
+{
+    const int level = qBound( 0, (int)Okular::SettingsCore::memoryLevel(), 3 );
+    first = qMax( 0, m_frameIndex - kPrefetchBehind[ level ] );
+    last = qMin( (int)m_frames.count() - 1, m_frameIndex + kPrefetchAhead[ level ] );
+}
+
+bool PresentationWidget::frameHasPixmap( int pageNumber ) const
+{
+    const PresentationFrame * frame = m_frames[ pageNumber ];
+    const qreal dpr = qApp->devicePixelRatio();
+    return frame->page->hasPixmap( this, ceil( frame->geometry.width() * dpr ), ceil( frame->geometry.height() * dpr ) );
 }
 
 void PresentationWidget::setupActions()
@@ -1404,56 +1429,70 @@ void PresentationWidget::repositionContent()
 
 void PresentationWidget::requestPixmaps()
 {
-    PresentationFrame * frame = m_frames[ m_frameIndex ];
-    int pixW = frame->geometry.width();
-    int pixH = frame->geometry.height();
+    // forget the timings of slides that fell out of the prefetch window,
+    // their requests are dropped by the document below
+    int first, last;
+    prefetchRange( first, last );
+    QHash< int, qint64 >::iterator it = m_prefetchRequestTimes.begin();
+    while ( it != m_prefetchRequestTimes.end() )
+    {
+        if ( it.key() < first || it.key() > last )
+            it = m_prefetchRequestTimes.erase( it );
+        else
+            ++it;
+    }
 
-    // operation will take long: set busy cursor
-    QApplication::setOverrideCursor( QCursor( Qt::BusyCursor ) );
-    // request the pixmap
     QLinkedList< Okular::PixmapRequest * > requests;
-    requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, pixW, pixH, PRESENTATION_PRIO, Okular::PixmapRequest::NoFeature ) );
-    // restore cursor
-    QApplication::restoreOverrideCursor();
-    // ask for next and previous page if not in low memory usage setting
-    if ( Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low )
+    if ( !frameHasPixmap( m_frameIndex ) )
     {
-        int pagesToPreload = 1;
+        PresentationFrame * frame = m_frames[ m_frameIndex ];
+        requests.push_back( new Okular::PixmapRequest( this, m_frameIndex, frame->geometry.width(), frame->geometry.height(), PRESENTATION_PRIO, Okular::PixmapRequest::NoFeature ) );
+        if ( !m_prefetchRequestTimes.contains( m_frameIndex ) )
+            m_prefetchRequestTimes.insert( m_frameIndex, m_prefetchClock.elapsed() );
+    }
 
+    // ask for the slides around the current one if not in low memory usage
+    // setting; the ones ahead go first since that is where auto advance and
+    // the presenter usually go
+    if ( Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low )
+    {
         // If greedy, preload everything
-        if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy)
-            pagesToPreload = (int)m_document->pages();
+        if ( Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy )
+        {
+            first = 0;
+            last = (int)m_document->pages() - 1;
+        }
 
         Okular::PixmapRequest::PixmapRequestFeatures requestFeatures = Okular::PixmapRequest::Preload;
         requestFeatures |= Okular::PixmapRequest::Asynchronous;
 
+        const int pagesToPreload = qMax( last - m_frameIndex, m_frameIndex - first );
         for( int j = 1; j <= pagesToPreload; j++ )
         {
             int tailRequest = m_frameIndex + j;
-            if ( tailRequest < (int)m_document->pages() )
+            if ( tailRequest <= last && !frameHasPixmap( tailRequest ) )
             {
                 PresentationFrame *nextFrame = m_frames[ tailRequest ];
-                pixW = nextFrame->geometry.width();
-                pixH = nextFrame->geometry.height();
-                if ( !nextFrame->page->hasPixmap( this, pixW, pixH ) )
-                    requests.push_back( new Okular::PixmapRequest( this, tailRequest, pixW, pixH, PRESENTATION_PRELOAD_PRIO, requestFeatures ) );
+                requests.push_back( new Okular::PixmapRequest( this, tailRequest, nextFrame->geometry.width(), nextFrame->geometry.height(), PRESENTATION_PRELOAD_PRIO, requestFeatures ) );
+                if ( !m_prefetchRequestTimes.contains( tailRequest ) )
+                    m_prefetchRequestTimes.insert( tailRequest, m_prefetchClock.elapsed() );
             }
 
             int headRequest = m_frameIndex - j;
-            if ( headRequest >= 0 )
+            if ( headRequest >= first && !frameHasPixmap( headRequest ) )
             {
                 PresentationFrame *prevFrame = m_frames[ headRequest ];
-                pixW = prevFrame->geometry.width();
-                pixH = prevFrame->geometry.height();
-                if ( !prevFrame->page->hasPixmap( this, pixW, pixH ) )
-                    requests.push_back( new Okular::PixmapRequest( this, headRequest, pixW, pixH, PRESENTATION_PRELOAD_PRIO, requestFeatures ) );
+                requests.push_back( new Okular::PixmapRequest( this, headRequest, prevFrame->geometry.width(), prevFrame->geometry.height(), PRESENTATION_PRELOAD_PRIO, requestFeatures ) );
+                if ( !m_prefetchRequestTimes.contains( headRequest ) )
+                    m_prefetchRequestTimes.insert( headRequest, m_prefetchClock.elapsed() );
             }
-
-            // stop if we've already reached both ends of the document
-            if ( headRequest < 0 && tailRequest >= (int)m_document->pages() )
-                break;
         }
     }
+
+    // the slides are all there, nothing to do
+    if ( requests.isEmpty() )
+        return;
+
     m_document->requestPixmaps( requests );
 }
 
@@ -1538,21 +1577,20 @@ void PresentationWidget::slotTransitionStep()
     {
         case Okular::PageTransition::Fade:
         {
-            QPainter pixmapPainter;
-            m_currentPixmapOpacity += 1.0 / m_transitionSteps;
-            m_lastRenderedPixmap = QPixmap( m_lastRenderedPixmap.size() );
-            m_lastRenderedPixmap.setDevicePixelRatio( qApp->devicePixelRatio() );
-            m_lastRenderedPixmap.fill( Qt::transparent );
-            pixmapPainter.begin( &m_lastRenderedPixmap );
-            pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
-            pixmapPainter.setOpacity( 1 - m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
-            pixmapPainter.setOpacity( m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
-            update();
-            if( m_currentPixmapOpacity >= 1 )
+            // progress follows the wall clock, so a slow frame is skipped
+            // instead of stretching the whole fade
+            m_currentPixmapOpacity = (double)m_transitionClock.elapsed() / m_transitionDuration;
+            if ( m_currentPixmapOpacity >= 1 )
+            {
+                m_lastRenderedPixmap = m_currentPagePixmap;
+                update();
                 return;
-        } break;
+            }
+            paintFadeStep( m_currentPixmapOpacity );
+            update();
+            m_transitionTimer->start( transitionFrameInterval() );
+            return;
+        }
         default:
         {
             if ( m_transitionRects.empty() )
@@ -1563,14 +1601,47 @@ void PresentationWidget::slotTransitionStep()
                 return;
             }
 
-            for ( int i = 0; i < m_transitionMul && !m_transitionRects.empty(); i++ )
+            // reveal all the rects that are due by now in a single repaint
+            const qint64 elapsed = m_transitionClock.elapsed();
+            const int done = m_transitionRectCount - m_transitionRects.count();
+            int due = m_transitionDuration > 0 ? (int)( m_transitionRectCount * elapsed / m_transitionDuration ) : m_transitionRectCount;
+            due = qMax( due - done, qMin( m_transitionMul, m_transitionRects.count() ) );
+            QRegion region;
+            for ( int i = 0; i < due && !m_transitionRects.empty(); i++ )
             {
-                update( m_transitionRects.first() );
+                region += m_transitionRects.first();
                 m_transitionRects.pop_front();
             }
+            update( region );
         } break;
     }
-    m_transitionTimer->start( m_transitionDelay );
+    m_transitionTimer->start( qMax( m_transitionDelay, transitionFrameInterval() ) );
+}
+
+void PresentationWidget::paintFadeStep( double opacity )
+{
+    // drop our reference first, so the buffer set up by initTransition()
+    // is blended in place instead of being detached
+    m_lastRenderedPixmap = QPixmap();
+    QPainter pixmapPainter( &m_transitionBuffer );
+    pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
+    if ( m_previousPagePixmap.isNull() )
+        pixmapPainter.fillRect( m_transitionBuffer.rect(), Qt::transparent );
+    else
+        pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
+    pixmapPainter.setCompositionMode( QPainter::CompositionMode_SourceOver );
+    pixmapPainter.setOpacity( opacity );
+    pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
+    pixmapPainter.end();
+    m_lastRenderedPixmap = m_transitionBuffer;
+}
+
+int PresentationWidget::transitionFrameInterval() const
+{
+    const QWindow *window = windowHandle();
+    const QScreen *screen = window ? window->screen() : QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen ? screen->refreshRate() : 0;
+    return refreshRate > 0 ? qMax( 1, qRound( 1000 / refreshRate ) ) : 16;
 }
 
 void PresentationWidget::slotDelayedEvents()
@@ -1990,6 +2061,13 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
     const bool isHorizontal = transition->alignment() == Okular::PageTransition::Horizontal;
     const float totalTime = transition->duration();
 
+    // a zero length transition is just a 'replace' one
+    if ( totalTime <= 0 )
+    {
+        update();
+        return;
+    }
+
     m_transitionRects.clear();
     m_currentTransition = *transition;
     m_currentPagePixmap = m_lastRenderedPixmap;
@@ -2336,21 +2414,16 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
 
         case Okular::PageTransition::Fade:
         {
-            enum {FADE_TRANSITION_FPS = 20};
-            const int steps = totalTime * FADE_TRANSITION_FPS;
-            m_transitionSteps = steps;
-            QPainter pixmapPainter;
-            m_currentPixmapOpacity = (double) 1 / steps;
-            m_transitionDelay = (int)( totalTime * 1000 ) / steps;
-            m_lastRenderedPixmap = QPixmap( m_lastRenderedPixmap.size() );
-            m_lastRenderedPixmap.fill( Qt::transparent );
-            pixmapPainter.begin( &m_lastRenderedPixmap );
-            pixmapPainter.setCompositionMode( QPainter::CompositionMode_Source );
-            pixmapPainter.setOpacity( 1 - m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_previousPagePixmap );
-            pixmapPainter.setOpacity( m_currentPixmapOpacity );
-            pixmapPainter.drawPixmap( 0, 0, m_currentPagePixmap );
-            pixmapPainter.end();
+            // only fades blend into a buffer, reuse it from the previous one
+            if ( m_transitionBuffer.size() != m_currentPagePixmap.size() )
+            {
+                m_transitionBuffer = QPixmap( m_currentPagePixmap.size() );
+                m_transitionBuffer.setDevicePixelRatio( m_currentPagePixmap.devicePixelRatio() );
+            }
+            // frames are paced by transitionFrameInterval(), not by a fixed step count
+            m_currentPixmapOpacity = 0;
+            m_transitionDelay = 0;
+            paintFadeStep( m_currentPixmapOpacity );
             update();
         } break;
         // implement missing transitions (a binary raster engine needed here)
@@ -2367,6 +2440,10 @@ void PresentationWidget::initTransition( const Okular::PageTransition *transitio
             return;
     }
 
+    m_transitionDuration = qMax( 1, (int)( totalTime * 1000 ) );
+    m_transitionRectCount = m_transitionRects.count();
+    m_transitionClock.start();
+
     // send the first start to the timer
     m_transitionTimer->start( 0 );
 }
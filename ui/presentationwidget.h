@@ -11,6 +11,8 @@
 #define _OKULAR_PRESENTATIONWIDGET_H_
 
 #include <QDomElement>
+#include <QElapsedTimer>
+#include <qhash.h>
 #include <qlist.h>
 #include <qpixmap.h>
 #include <qstringlist.h>
@@ -86,6 +88,10 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         void generateContentsPage( int page, QPainter & p );
         void generateOverlay();
         void initTransition( const Okular::PageTransition *transition );
+        void paintFadeStep( double opacity );
+        void prefetchRange( int &first, int &last ) const;
+        bool frameHasPixmap( int pageNumber ) const;
+        int transitionFrameInterval() const;
         const Okular::PageTransition defaultTransition() const;
         const Okular::PageTransition defaultTransition( int ) const;
         QRect routeMouseDrawingEvent( QMouseEvent * );
@@ -106,6 +112,7 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         int m_width;
         int m_height;
         QPixmap m_lastRenderedPixmap;
+        QPixmap m_transitionBuffer;
         QPixmap m_lastRenderedOverlay;
         QRect m_overlayGeometry;
         const Okular::Action * m_pressedLink;
@@ -122,13 +129,19 @@ class PresentationWidget : public QWidget, public Okular::DocumentObserver
         QTimer * m_nextPageTimer;
         int m_transitionDelay;
         int m_transitionMul;
-        int m_transitionSteps;
+        int m_transitionDuration;
+        int m_transitionRectCount;
+        QElapsedTimer m_transitionClock;
         QList< QRect > m_transitionRects;
         Okular::PageTransition m_currentTransition;
         QPixmap m_currentPagePixmap;
         QPixmap m_previousPagePixmap;
         double m_currentPixmapOpacity;
 
+        // prefetch related
+        QElapsedTimer m_prefetchClock;
+        QHash< int, qint64 > m_prefetchRequestTimes;
+
         // misc stuff
         QWidget * m_parentWidget;
         Okular::Document * m_document;
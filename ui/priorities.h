@@ -13,6 +13,7 @@
 /** PRIORITIES for requests. Globally defined here. **/
 #define PAGEVIEW_PRIO 1
 #define PAGEVIEW_PRELOAD_PRIO 4
+#define PAGEVIEW_PRELOAD_BEHIND_PRIO 6
 #define THUMBNAILS_PRIO 2
 #define THUMBNAILS_PRELOAD_PRIO 5
 #define PRESENTATION_PRIO 0
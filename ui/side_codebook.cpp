@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "side_codebook.h"
+
+// qt/kde includes
+#include <QHeaderView>
+#include <QLayout>
+#include <QTreeView>
+
+#include <klineedit.h>
+#include <KLocalizedString>
+
+// local includes
+#include "core/document.h"
+#include "codebookmodel.h"
+
+Codebook::Codebook( QWidget * parent, Okular::Document * document )
+    : QWidget( parent ), m_document( document )
+{
+    // create widgets and layout them vertically
+    QVBoxLayout * vLayout = new QVBoxLayout( this );
+    vLayout->setMargin( 0 );
+    vLayout->setSpacing( 6 );
+
+    m_searchLine = new KLineEdit( this );
+    m_searchLine->setClearButtonEnabled( true );
+    m_searchLine->setPlaceholderText( i18n( "Search..." ) );
+    connect(m_searchLine, &KLineEdit::textChanged, this, &Codebook::filterChanged);
+
+    m_view = new QTreeView( this );
+    m_view->setAlternatingRowColors( true );
+    m_view->setUniformRowHeights( true );
+    m_view->setSortingEnabled( true );
+    m_view->sortByColumn( -1, Qt::AscendingOrder );
+
+    m_model = new CodebookModel( m_document, m_view );
+    m_filterProxy = new CodebookFilterProxyModel( m_view );
+    m_filterProxy->setSourceModel( m_model );
+    m_view->setModel( m_filterProxy );
+
+    m_view->header()->setStretchLastSection( false );
+    m_view->header()->setSectionResizeMode( 0, QHeaderView::Stretch );
+    m_view->header()->setSectionResizeMode( 1, QHeaderView::ResizeToContents );
+
+    vLayout->addWidget( m_searchLine );
+    vLayout->addWidget( m_view );
+
+    connect(m_view, &QTreeView::activated, this, &Codebook::activated);
+}
+
+Codebook::~Codebook()
+{
+}
+
+CodebookModel * Codebook::model() const
+{
+    return m_model;
+}
+
+void Codebook::activated( const QModelIndex &index )
+{
+    Okular::QDANode *node = m_model->nodeForIndex( m_filterProxy->mapToSource( index ) );
+    if ( !node )
+        return;
+
+    // go to the next page coded with the node
+    const int pageNumber = m_model->nextCodingPage( node, m_document->currentPage() );
+    if ( pageNumber == -1 )
+        return;
+
+    m_document->setViewportPage( pageNumber );
+}
+
+void Codebook::filterChanged( const QString &text )
+{
+    m_filterProxy->setFilterFixedString( text );
+
+    // show where the matching codes are
+    if ( !text.isEmpty() )
+        m_view->expandAll();
+}
+
+#include "moc_side_codebook.cpp"
@@ -0,0 +1,52 @@
+/***************************************************************************
+ *   Copyright (C) 2026 by agent <agent@local>                             *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_SIDE_CODEBOOK_H_
+#define _OKULAR_SIDE_CODEBOOK_H_
+
+#include <QWidget>
+
+class QModelIndex;
+class QTreeView;
+class KLineEdit;
+
+namespace Okular {
+class Document;
+}
+
+class CodebookModel;
+class CodebookFilterProxyModel;
+
+/**
+ * @short The QDA codebook, with the number of codings of each node.
+ */
+class Codebook : public QWidget
+{
+    Q_OBJECT
+    public:
+        Codebook( QWidget * parent, Okular::Document * document );
+        ~Codebook();
+
+        CodebookModel * model() const;
+
+    private Q_SLOTS:
+        void activated( const QModelIndex& );
+        void filterChanged( const QString& );
+
+    private:
+        // data fields (GUI)
+        KLineEdit *m_searchLine;
+        QTreeView *m_view;
+        // internal storage
+        Okular::Document * m_document;
+        CodebookModel * m_model;
+        CodebookFilterProxyModel * m_filterProxy;
+};
+
+#endif
@@ -12,6 +12,7 @@
 // qt/kde includes
 
 #include <qcombobox.h>
+#include <qcompleter.h>
 #include <qlabel.h>
 #include <qlayout.h>
 #include <qlineedit.h>
@@ -68,18 +69,26 @@ QWidget * TaggingWidget::createNodeWidget()
     tmplabel->setBuddy( m_nodeBox );
     nodeLay->addWidget( m_nodeBox, 0 );
 
+    // the rows of the box follow QDANodeUtils::QDANodes, see applyChanges()
     QList< Okular::QDANode * >::const_iterator nIt = Okular::QDANodeUtils::QDANodes.constBegin(), nEnd = Okular::QDANodeUtils::QDANodes.constEnd();
     int i = 0;
     for ( ; nIt != nEnd; ++nIt )
     {
-        QPixmap pixmap(100,100);
+        QPixmap pixmap(16,16);
         pixmap.fill((*nIt)->color());
         m_nodeBox->addItem( pixmap, (*nIt)->name() );
-        if ( (*nIt)->uniqueName() == m_tag->node()->uniqueName() )
+        if ( *nIt == m_tag->node() )
             m_nodeBox->setCurrentIndex( i );
         i++;
     }
 
+    // type to search, so large codebooks stay usable
+    QCompleter * completer = new QCompleter( m_nodeBox->model(), m_nodeBox );
+    completer->setCaseSensitivity( Qt::CaseInsensitive );
+    completer->setFilterMode( Qt::MatchContains );
+    completer->setCompletionMode( QCompleter::PopupCompletion );
+    m_nodeBox->setCompleter( completer );
+
     m_attrArea = new QScrollArea( widget );
     m_attrArea->setWidgetResizable( true );
 